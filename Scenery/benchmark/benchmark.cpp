@@ -0,0 +1,874 @@
+// Замер скорости Process::step без камеры, окна OpenGL и окна отладки.
+//
+// Кадры видеофайла или сырого дампа (кадры BGR подряд, без заголовка)
+// загружаются в память, затем прогоняются через каждый режим Process
+// и каждый режим кластеризации (движение - по разности кадров и по модели
+// фона). Для каждого этапа выводятся перцентили
+// времени в микросекундах и кадры в секунду, в формате JSON.
+//
+// С --synthetic WxH кадры рисует SyntheticScene (--blobs, --radius,
+// --speed, --noise, --occlusion, --seed), и для каждого прогона
+// дополнительно выводится точность по истинным положениям кругов.
+// Все кадры хранятся в памяти: для 4K задавайте небольшое --frames.
+//
+// С --streams N дополнительно замеряется, как растет общая пропускная
+// способность, когда 1..N потоков Process обрабатывают кадры параллельно
+// (режим Color, кластеризация Simple).
+//
+// Попиксельные этапы делят строки кадра между --threads N потоками
+// (по умолчанию 1). Отдельно замеряется этап detect режимов Color
+// и Motion на 1, 2, 4 и 8 потоках, и этап cluster режима Color
+// с разной высотой полос разметки; результат каждого варианта
+// сравнивается с разметкой одной полосой в одном потоке.
+//
+// --simd scalar|sse2|avx2 ограничивает набор инструкций ProcessSimd,
+// чтобы сравнить векторные ядра со скалярными на том же разрешении.
+// Этап detect режима Color замеряется и отдельно: по таблице ColorTable
+// и векторным ядром, чтобы было видно, какой путь выбирать.
+// Таблица строится в своем потоке, поэтому каждый замер режима Color
+// начинается после ее построения, а в "colorPath" указан путь, которым
+// на самом деле шли замеренные кадры (table, simd или mixed).
+//
+//   benchmark video.avi [--frames N] [--haar cascade.xml] [--streams N] [--simd sse2] [--out result.json]
+//   benchmark dump.raw --size 640x480 [--frames N] ...
+//   benchmark --synthetic 3840x2160 --blobs 16 --noise 20 --occlusion 0.2 [--frames N] ...
+
+#include <QCoreApplication>
+#include <QThread>
+#include <QStringList>
+#include <QFile>
+#include <QTextStream>
+#include <QVector>
+
+#include <opencv/highgui.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <math.h>
+
+#include "../process/process.h"
+#include "../process/processtools.h"
+#include "../process/clock.h"
+#include "../process/processsimd.h"
+#include "../process/synthetic.h"
+
+// Сколько первых кадров не учитывается (таблицы, кэши)
+#define WARMUP_FRAMES 10
+
+static const char *modeName(Process::Mode mode)
+{
+    switch (mode) {
+    case Process::ProcessNone:         return "none";
+    case Process::ProcessColor:        return "color";
+    case Process::ProcessMotion:       return "motion";
+    case Process::ProcessHaar:         return "haar";
+    case Process::ProcessContour:      return "contour";
+    case Process::ProcessHoughCircles: return "houghCircles";
+    }
+    return "";
+}
+
+static const char *clusterName(Clustering::ClusterMode mode)
+{
+    switch (mode) {
+    case Clustering::ClusterNone:   return "none";
+    case Clustering::ClusterSimple: return "simple";
+    case Clustering::ClusterTable:  return "table";
+    }
+    return "";
+}
+
+static const char *simdName(ProcessSimd::Instructions instructions)
+{
+    switch (instructions) {
+    case ProcessSimd::Scalar: return "scalar";
+    case ProcessSimd::SSE2:   return "sse2";
+    case ProcessSimd::AVX2:   return "avx2";
+    }
+    return "";
+}
+
+static const char *colorPathName(Process::ColorPath path)
+{
+    switch (path) {
+    case Process::ColorPathAuto:  return "auto";
+    case Process::ColorPathTable: return "table";
+    case Process::ColorPathSimd:  return "simd";
+    }
+    return "";
+}
+
+static const char *motionName(Process::MotionMode mode)
+{
+    switch (mode) {
+    case Process::MotionFrameDiff:  return "frameDiff";
+    case Process::MotionBackground: return "background";
+    }
+    return "";
+}
+
+// Каким путем шли кадры режима Color: table кадров из count по таблице
+static const char *colorPathUsed(int table, int count)
+{
+    if ( table == 0 )
+        return "simd";
+    if ( table == count )
+        return "table";
+    return "mixed";
+}
+
+// Режимы, в которых результат зависит от кластеризации
+static bool usesClustering(Process::Mode mode)
+{
+    return mode == Process::ProcessColor
+        || mode == Process::ProcessMotion
+        || mode == Process::ProcessContour;
+}
+
+// ========================================================================
+// Загрузка кадров
+// ========================================================================
+
+// Кадры кладутся в кольцо по одному и сразу забираются ссылкой,
+// поэтому пул кольца вырастает до количества кадров
+static bool loadVideo(QString file, int maxFrames, FrameRing *&ring, QVector<Frame> &frames)
+{
+    CvCapture *capture = cvCreateFileCapture(file.toLocal8Bit().constData());
+    if (!capture)
+        return false;
+
+    while ( frames.size() < maxFrames ) {
+        IplImage *image = cvQueryFrame(capture);
+        if (!image)
+            break;
+
+        if (!ring)
+            ring = new FrameRing(image->width, image->height);
+
+        FramePool::copy(image, ring->beginWrite());
+        ring->endWrite(frames.size() + 1, Clock::now());
+
+        Frame frame;
+        ring->acquire(frame);
+        frames.append(frame);
+    }
+
+    cvReleaseCapture(&capture);
+    return true;
+}
+
+static bool loadRaw(QString file, int width, int height, int maxFrames,
+                    FrameRing *&ring, QVector<Frame> &frames)
+{
+    QFile raw(file);
+    if ( !raw.open(QIODevice::ReadOnly) )
+        return false;
+
+    ring = new FrameRing(width, height);
+
+    while ( frames.size() < maxFrames ) {
+        IplImage *image = ring->beginWrite();
+
+        bool full = true;
+        for ( int y=0; y<height && full; y++ ) {
+            char *row = image->imageData + y * image->widthStep;
+            full = raw.read(row, width * 3) == width * 3;
+        }
+
+        // Последний кадр файла неполный, его не публикуем
+        if (!full)
+            break;
+
+        ring->endWrite(frames.size() + 1, Clock::now());
+
+        Frame frame;
+        ring->acquire(frame);
+        frames.append(frame);
+    }
+
+    return true;
+}
+
+typedef QVector< vector<SyntheticScene::Blob> > Truth;
+
+static void loadSynthetic(int width, int height, SyntheticScene::Param param, int maxFrames,
+                          FrameRing *&ring, QVector<Frame> &frames, Truth &truth)
+{
+    ring = new FrameRing(width, height);
+
+    SyntheticScene scene(width, height);
+    scene.setParam(param);
+
+    while ( frames.size() < maxFrames ) {
+        scene.render( ring->beginWrite() );
+        ring->endWrite(frames.size() + 1, Clock::now());
+
+        Frame frame;
+        ring->acquire(frame);
+        frames.append(frame);
+        truth.append(scene.getBlobs());
+    }
+}
+
+// ========================================================================
+// Статистика
+// ========================================================================
+
+// Перцентиль p (0..1) отсортированных значений
+static qint64 percentile(const QVector<qint64> &sorted, double p)
+{
+    if ( sorted.isEmpty() )
+        return 0;
+
+    int i = (int)(p * sorted.size() + 0.999999) - 1;
+    return sorted[qBound(0, i, sorted.size() - 1)];
+}
+
+static void writeTimes(QTextStream &out, QString name, QVector<qint64> times, bool last)
+{
+    std::sort(times.begin(), times.end());
+
+    out << "        \"" << name << "\": {"
+        << "\"p50\": " << percentile(times, 0.50) << ", "
+        << "\"p95\": " << percentile(times, 0.95) << ", "
+        << "\"p99\": " << percentile(times, 0.99) << ", "
+        << "\"max\": " << (times.isEmpty() ? 0 : times.last()) << "}"
+        << (last ? "\n" : ",\n");
+}
+
+// Точность по истинным положениям SyntheticScene
+struct Accuracy {
+    int truth;          // Видимых кругов во всех кадрах
+    int matched;        // Из них найдено регионом в пределах радиуса
+    int areas;          // Всего регионов
+    int areasMatched;   // Регионов, рядом с которыми есть круг
+    double error;       // Сумма расстояний от круга до его региона
+    int idSwitches;     // Смены номера последовательности у одного круга
+
+    QVector<unsigned int> tracks;   // Последний номер последовательности круга
+
+    Accuracy() : truth(0), matched(0), areas(0), areasMatched(0), error(0), idSwitches(0) {}
+
+    void add(const vector<SyntheticScene::Blob> &blobs, const Areas &found,
+             const SeqAreas &seqAreas, int radius);
+};
+
+static double distance(const SyntheticScene::Blob &blob, const int pt[2])
+{
+    double dx = blob.x - pt[0];
+    double dy = blob.y - pt[1];
+    return sqrt(dx*dx + dy*dy);
+}
+
+void Accuracy::add(const vector<SyntheticScene::Blob> &blobs, const Areas &found,
+                   const SeqAreas &seqAreas, int radius)
+{
+    if ( tracks.size() < (int)blobs.size() + 1 )
+        tracks.resize(blobs.size() + 1);
+
+    for ( unsigned int i=0; i<blobs.size(); i++ ) {
+        const SyntheticScene::Blob &blob = blobs[i];
+        if ( !blob.visible )
+            continue;
+        truth++;
+
+        double best = radius;
+        for ( unsigned int j=0; j<found.size(); j++ )
+            best = qMin(best, distance(blob, found[j].ptReal));
+
+        if ( best < radius ) {
+            matched++;
+            error += best;
+        }
+
+        // Последовательность, ближайшая к кругу
+        unsigned int number = 0;
+        double bestTrack = radius;
+        for ( unsigned int j=0; j<seqAreas.size(); j++ ) {
+            if ( !seqAreas[j].number )
+                continue;
+            double d = distance(blob, seqAreas[j].ptReal);
+            if ( d < bestTrack ) {
+                bestTrack = d;
+                number = seqAreas[j].number;
+            }
+        }
+
+        if ( number ) {
+            if ( tracks[blob.id] && tracks[blob.id] != number )
+                idSwitches++;
+            tracks[blob.id] = number;
+        }
+    }
+
+    for ( unsigned int j=0; j<found.size(); j++ ) {
+        areas++;
+        for ( unsigned int i=0; i<blobs.size(); i++ ) {
+            if ( distance(blobs[i], found[j].ptReal) < radius ) {
+                areasMatched++;
+                break;
+            }
+        }
+    }
+}
+
+// Прогон всех кадров в одном режиме. Если truth не пуст,
+// считается и точность
+static void run(QTextStream &out, Process &process, const QVector<Frame> &frames,
+                const Truth &truth, int radius,
+                Process::Mode mode, Clustering::ClusterMode clusterMode, bool last)
+{
+    process.setMode(mode);
+    process.setClusterMode(clusterMode);
+    process.waitColorTable();
+
+    QVector<qint64> stages[Process::StageCount];
+    QVector<qint64> total;
+    Accuracy accuracy;
+    int tableFrames = 0;
+
+    qint64 begin = 0;
+    for ( int i=0; i<frames.size(); i++ ) {
+        if ( i == WARMUP_FRAMES )
+            begin = Clock::now();
+
+        qint64 start = Clock::now();
+        process.setFrame(frames[i]);
+        process.step();
+        qint64 time = Clock::now() - start;
+
+        if ( i < WARMUP_FRAMES )
+            continue;
+
+        total.append(time);
+        for ( int s=0; s<Process::StageCount; s++ )
+            stages[s].append( process.getStageTime((Process::Stage)s) );
+        if ( process.isColorTableUsed() )
+            tableFrames++;
+
+        if ( !truth.isEmpty() )
+            accuracy.add(truth[i], process.getAreas(), process.getSeqAreas(), radius);
+    }
+
+    qint64 elapsed = Clock::now() - begin;
+    double fps = elapsed > 0 ? total.size() * 1000000.0 / elapsed : 0;
+
+    // Для движения в имени прогона указывается и модель
+    QString name = modeName(mode);
+    if ( mode == Process::ProcessMotion )
+        name += QString("/") + motionName(process.getMotionParam().mode);
+
+    out << "    {\n"
+        << "      \"mode\": \"" << name << "\",\n"
+        << "      \"cluster\": \"" << clusterName(clusterMode) << "\",\n";
+    if ( mode == Process::ProcessColor )
+        out << "      \"colorPath\": \"" << colorPathUsed(tableFrames, total.size()) << "\",\n";
+    out << "      \"frames\": " << total.size() << ",\n"
+        << "      \"fps\": " << QString::number(fps, 'f', 1) << ",\n"
+        << "      \"stages\": {\n";
+
+    for ( int s=0; s<Process::StageCount; s++ )
+        writeTimes(out, Process::getStageName((Process::Stage)s), stages[s], false);
+    writeTimes(out, "total", total, true);
+
+    out << "      }";
+
+    if ( !truth.isEmpty() ) {
+        double recall = accuracy.truth ? (double)accuracy.matched / accuracy.truth : 0;
+        double precision = accuracy.areas ? (double)accuracy.areasMatched / accuracy.areas : 0;
+        double error = accuracy.matched ? accuracy.error / accuracy.matched : 0;
+
+        out << ",\n"
+            << "      \"accuracy\": {"
+            << "\"recall\": " << QString::number(recall, 'f', 3) << ", "
+            << "\"precision\": " << QString::number(precision, 'f', 3) << ", "
+            << "\"meanError\": " << QString::number(error, 'f', 2) << ", "
+            << "\"idSwitches\": " << accuracy.idSwitches << "}";
+
+        fprintf(stderr, "%s/%s: %.1f fps, recall %.3f, precision %.3f, error %.2f px\n",
+                name.toLocal8Bit().constData(), clusterName(clusterMode), fps, recall, precision, error);
+    }
+    else
+        fprintf(stderr, "%s/%s: %.1f fps\n", name.toLocal8Bit().constData(), clusterName(clusterMode), fps);
+
+    out << "\n"
+        << "    }" << (last ? "\n" : ",\n");
+}
+
+// ========================================================================
+// Масштабирование по количеству потоков
+// ========================================================================
+
+// Один поток: свой Process прогоняет все кадры, как поток обработки
+// одного входа в Manager
+class Stream : public QThread
+{
+public:
+    Stream(const QVector<Frame> &frames) :
+        frames(frames),
+        process(frames[0].getImage()->width, frames[0].getImage()->height)
+    {
+        process.setMode(Process::ProcessColor);
+        process.setClusterMode(Clustering::ClusterSimple);
+        process.waitColorTable();
+        processed = 0;
+    }
+
+    int getProcessed() { return processed; }
+
+protected:
+    void run()
+    {
+        for ( int i=0; i<frames.size(); i++ ) {
+            process.setFrame(frames[i]);
+            process.step();
+        }
+        processed = frames.size();
+    }
+
+private:
+    const QVector<Frame> &frames;
+    Process process;
+    int processed;
+};
+
+static void runStreams(QTextStream &out, const QVector<Frame> &frames, int count, bool last)
+{
+    QVector<Stream *> streams;
+    for ( int i=0; i<count; i++ )
+        streams.append(new Stream(frames));
+
+    // Первый проход прогревает таблицы и буферы каждого Process
+    for ( int i=0; i<count; i++ )
+        streams[i]->start();
+    for ( int i=0; i<count; i++ )
+        streams[i]->wait();
+
+    qint64 begin = Clock::now();
+    for ( int i=0; i<count; i++ )
+        streams[i]->start();
+    for ( int i=0; i<count; i++ )
+        streams[i]->wait();
+    qint64 elapsed = Clock::now() - begin;
+
+    int processed = 0;
+    for ( int i=0; i<count; i++ ) {
+        processed += streams[i]->getProcessed();
+        delete streams[i];
+    }
+
+    double fps = elapsed > 0 ? processed * 1000000.0 / elapsed : 0;
+
+    out << "    {\"streams\": " << count << ", "
+        << "\"fps\": " << QString::number(fps, 'f', 1) << ", "
+        << "\"fpsPerStream\": " << QString::number(fps / count, 'f', 1) << "}"
+        << (last ? "\n" : ",\n");
+
+    fprintf(stderr, "streams %d: %.1f fps (%.1f per stream)\n", count, fps, fps / count);
+}
+
+// ========================================================================
+// Масштабирование попиксельных этапов по потокам ThreadPool
+// ========================================================================
+
+static void runThreads(QTextStream &out, Process &process, const QVector<Frame> &frames,
+                       Process::Mode mode, int threads, bool last)
+{
+    process.setMode(mode);
+    process.setClusterMode(Clustering::ClusterSimple);
+    process.setThreadCount(threads);
+    process.waitColorTable();
+
+    QVector<qint64> detect;
+    int tableFrames = 0;
+
+    qint64 begin = 0;
+    for ( int i=0; i<frames.size(); i++ ) {
+        if ( i == WARMUP_FRAMES )
+            begin = Clock::now();
+
+        process.setFrame(frames[i]);
+        process.step();
+
+        if ( i < WARMUP_FRAMES )
+            continue;
+
+        detect.append( process.getStageTime(Process::StageDetect) );
+        if ( process.isColorTableUsed() )
+            tableFrames++;
+    }
+
+    qint64 elapsed = Clock::now() - begin;
+    double fps = elapsed > 0 ? detect.size() * 1000000.0 / elapsed : 0;
+
+    std::sort(detect.begin(), detect.end());
+    qint64 p50 = percentile(detect, 0.5);
+
+    out << "    {\"mode\": \"" << modeName(mode) << "\", ";
+    if ( mode == Process::ProcessColor )
+        out << "\"colorPath\": \"" << colorPathUsed(tableFrames, detect.size()) << "\", ";
+    out << "\"threads\": " << threads << ", "
+        << "\"fps\": " << QString::number(fps, 'f', 1) << ", "
+        << "\"detectP50\": " << p50 << "}"
+        << (last ? "\n" : ",\n");
+
+    fprintf(stderr, "%s threads %d: %.1f fps, detect p50 %lld us\n",
+            modeName(mode), threads, fps, p50);
+}
+
+// ========================================================================
+// Условие цвета: таблица или векторное ядро
+// ========================================================================
+
+static void runColorPath(QTextStream &out, Process &process, const QVector<Frame> &frames,
+                         Process::ColorPath path, bool last)
+{
+    process.setMode(Process::ProcessColor);
+    process.setClusterMode(Clustering::ClusterNone);
+    process.setColorPath(path);
+
+    // Таблица строится в своем потоке, замер начинается, когда она готова
+    process.waitColorTable();
+
+    QVector<qint64> detect;
+
+    for ( int i=0; i<frames.size(); i++ ) {
+        process.setFrame(frames[i]);
+        process.step();
+
+        if ( i >= WARMUP_FRAMES )
+            detect.append( process.getStageTime(Process::StageDetect) );
+    }
+
+    std::sort(detect.begin(), detect.end());
+    qint64 p50 = percentile(detect, 0.5);
+
+    out << "    {\"path\": \"" << colorPathName(path) << "\", "
+        << "\"detectP50\": " << p50 << "}"
+        << (last ? "\n" : ",\n");
+
+    fprintf(stderr, "color %s: detect p50 %lld us\n", colorPathName(path), p50);
+}
+
+// ========================================================================
+// Параллельная разметка отрезков по полосам
+// ========================================================================
+
+static bool sameAreas(const Areas &a, const Areas &b)
+{
+    if ( a.size() != b.size() )
+        return false;
+
+    for ( unsigned int i=0; i<a.size(); i++ ) {
+        if ( a[i].ptReal[0] != b[i].ptReal[0] || a[i].ptReal[1] != b[i].ptReal[1]
+          || a[i].widthReal != b[i].widthReal || a[i].heightReal != b[i].heightReal )
+            return false;
+    }
+    return true;
+}
+
+static void setTiles(Process &process, Clustering::SimpleClusterParam param,
+                     int tileRows, int threads)
+{
+    param.tileRows = tileRows;
+    process.setMode(Process::ProcessColor);
+    process.setClusterMode(Clustering::ClusterSimple);
+    process.setSimpleClusterParam(param);
+    process.setThreadCount(threads);
+    process.waitColorTable();
+}
+
+// Регионы каждого кадра при разметке одной полосой в одном потоке
+static void findReference(Process &process, const QVector<Frame> &frames,
+                          Clustering::SimpleClusterParam param, QVector<Areas> &reference)
+{
+    setTiles(process, param, frames[0].getImage()->height, 1);
+
+    for ( int i=0; i<frames.size(); i++ ) {
+        process.setFrame(frames[i]);
+        process.step();
+        reference.append(process.getAreas());
+    }
+}
+
+static void runTiles(QTextStream &out, Process &process, const QVector<Frame> &frames,
+                     Clustering::SimpleClusterParam param, const QVector<Areas> &reference,
+                     int tileRows, int threads, bool last)
+{
+    setTiles(process, param, tileRows, threads);
+
+    QVector<qint64> cluster;
+    bool identical = true;
+
+    for ( int i=0; i<frames.size(); i++ ) {
+        process.setFrame(frames[i]);
+        process.step();
+
+        if ( !sameAreas(process.getAreas(), reference[i]) )
+            identical = false;
+
+        if ( i >= WARMUP_FRAMES )
+            cluster.append( process.getStageTime(Process::StageCluster) );
+    }
+
+    std::sort(cluster.begin(), cluster.end());
+    qint64 p50 = percentile(cluster, 0.5);
+
+    out << "    {\"tileRows\": " << tileRows << ", "
+        << "\"threads\": " << threads << ", "
+        << "\"clusterP50\": " << p50 << ", "
+        << "\"identical\": " << (identical ? "true" : "false") << "}"
+        << (last ? "\n" : ",\n");
+
+    fprintf(stderr, "tiles %d rows, threads %d: cluster p50 %lld us%s\n",
+            tileRows, threads, p50, identical ? "" : ", AREAS DIFFER");
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QStringList args = a.arguments();
+
+    QString source;
+    QString outFile;
+    QString haarFile;
+    int width = 0;
+    int height = 0;
+    int maxFrames = 300;
+    int maxStreams = 0;
+    int threads = 1;
+    bool synthetic = false;
+    SyntheticScene::Param syntheticParam = SyntheticScene::defaultParam();
+
+    for ( int i=1; i<args.size(); i++ ) {
+        if ( args[i] == "--frames" && i+1 < args.size() )
+            maxFrames = args[++i].toInt();
+        else if ( (args[i] == "--size" || args[i] == "--synthetic") && i+1 < args.size() ) {
+            synthetic = args[i] == "--synthetic";
+            QStringList size = args[++i].split('x');
+            if ( size.size() == 2 ) {
+                width = size[0].toInt();
+                height = size[1].toInt();
+            }
+        }
+        else if ( args[i] == "--blobs" && i+1 < args.size() )
+            syntheticParam.blobs = args[++i].toInt();
+        else if ( args[i] == "--radius" && i+1 < args.size() )
+            syntheticParam.radius = args[++i].toInt();
+        else if ( args[i] == "--speed" && i+1 < args.size() )
+            syntheticParam.speed = args[++i].toDouble();
+        else if ( args[i] == "--noise" && i+1 < args.size() )
+            syntheticParam.noise = args[++i].toInt();
+        else if ( args[i] == "--occlusion" && i+1 < args.size() )
+            syntheticParam.occlusion = args[++i].toDouble();
+        else if ( args[i] == "--seed" && i+1 < args.size() )
+            syntheticParam.seed = args[++i].toUInt();
+        else if ( args[i] == "--haar" && i+1 < args.size() )
+            haarFile = args[++i];
+        else if ( args[i] == "--streams" && i+1 < args.size() )
+            maxStreams = args[++i].toInt();
+        else if ( args[i] == "--threads" && i+1 < args.size() )
+            threads = qMax(1, args[++i].toInt());
+        else if ( args[i] == "--simd" && i+1 < args.size() ) {
+            QString name = args[++i];
+            if ( name == "scalar" )
+                ProcessSimd::setInstructions(ProcessSimd::Scalar);
+            else if ( name == "sse2" )
+                ProcessSimd::setInstructions(ProcessSimd::SSE2);
+            else if ( name == "avx2" )
+                ProcessSimd::setInstructions(ProcessSimd::AVX2);
+        }
+        else if ( args[i] == "--out" && i+1 < args.size() )
+            outFile = args[++i];
+        else
+            source = args[i];
+    }
+
+    if ( synthetic )
+        source = QString("synthetic:%1x%2").arg(width).arg(height);
+
+    if ( source.isEmpty() || (synthetic && (width <= 0 || height <= 0)) ) {
+        fprintf(stderr, "usage: benchmark <video | dump.raw --size WxH | --synthetic WxH "
+                        "[--blobs N] [--radius R] [--speed S] [--noise A] [--occlusion F] [--seed N]> "
+                        "[--frames N] [--haar cascade.xml] [--streams N] [--threads N] [--simd scalar|sse2|avx2] "
+                        "[--out result.json]\n");
+        return 1;
+    }
+
+    ProcessTools::initRGB2HSV("rgb2hsv.cache");
+
+    FrameRing *ring = 0;
+    QVector<Frame> frames;
+    Truth truth;
+    bool loaded = true;
+
+    if (synthetic)
+        loadSynthetic(width, height, syntheticParam, maxFrames, ring, frames, truth);
+    else if ( width > 0 && height > 0 )
+        loaded = loadRaw(source, width, height, maxFrames, ring, frames);
+    else
+        loaded = loadVideo(source, maxFrames, ring, frames);
+
+    if ( !loaded || frames.size() <= WARMUP_FRAMES ) {
+        fprintf(stderr, "benchmark: not enough frames in %s\n", source.toLocal8Bit().constData());
+        return 1;
+    }
+
+    // Загрузка копирует каждый кадр в кольцо и растит пул до количества
+    // кадров. В "allocations" и "copies" попадает только обработка
+    FramePool::resetCounters();
+
+    QFile file(outFile);
+    bool opened = outFile.isEmpty()
+            ? file.open(stdout, QIODevice::WriteOnly)
+            : file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+
+    if ( !opened ) {
+        fprintf(stderr, "benchmark: cannot write %s\n", outFile.toLocal8Bit().constData());
+        return 1;
+    }
+    QTextStream out(&file);
+
+    int frameWidth = frames[0].getImage()->width;
+    int frameHeight = frames[0].getImage()->height;
+
+    QList<Process::Mode> modes;
+    modes << Process::ProcessColor << Process::ProcessMotion
+          << Process::ProcessContour << Process::ProcessHoughCircles;
+    if ( !haarFile.isEmpty() )
+        modes << Process::ProcessHaar;
+
+    QList<Clustering::ClusterMode> clusterModes;
+    clusterModes << Clustering::ClusterNone << Clustering::ClusterSimple
+                 << Clustering::ClusterTable;
+
+    QList<Process::MotionMode> motionModes;
+    motionModes << Process::MotionFrameDiff << Process::MotionBackground;
+
+    out << "{\n"
+        << "  \"source\": \"" << QString(source).replace('\\', "\\\\").replace('"', "\\\"") << "\",\n"
+        << "  \"width\": " << frameWidth << ",\n"
+        << "  \"height\": " << frameHeight << ",\n"
+        << "  \"frames\": " << frames.size() << ",\n"
+        << "  \"warmup\": " << WARMUP_FRAMES << ",\n"
+        << "  \"simd\": \"" << simdName(ProcessSimd::instructions()) << "\",\n"
+        << "  \"threads\": " << threads << ",\n";
+
+    if (synthetic) {
+        out << "  \"synthetic\": {"
+            << "\"blobs\": " << syntheticParam.blobs << ", "
+            << "\"radius\": " << syntheticParam.radius << ", "
+            << "\"speed\": " << syntheticParam.speed << ", "
+            << "\"noise\": " << syntheticParam.noise << ", "
+            << "\"occlusion\": " << syntheticParam.occlusion << ", "
+            << "\"seed\": " << syntheticParam.seed << "},\n";
+    }
+
+    out << "  \"units\": \"us\",\n"
+        << "  \"runs\": [\n";
+
+    {
+        Process process(frameWidth, frameHeight);
+        process.setThreadCount(threads);
+        if ( !haarFile.isEmpty() ) {
+            process.setHaarFile(haarFile.toStdString());
+            process.waitHaarFile();
+        }
+
+        for ( int m=0; m<modes.size(); m++ ) {
+            bool lastMode = m == modes.size() - 1;
+
+            if ( !usesClustering(modes[m]) ) {
+                run(out, process, frames, truth, syntheticParam.radius,
+                    modes[m], Clustering::ClusterNone, lastMode);
+                continue;
+            }
+
+            // Модель движения меняется только в режиме Motion
+            int variants = modes[m] == Process::ProcessMotion ? motionModes.size() : 1;
+            for ( int v=0; v<variants; v++ ) {
+                if ( modes[m] == Process::ProcessMotion ) {
+                    Process::MotionParam motionParam = process.getMotionParam();
+                    motionParam.mode = motionModes[v];
+                    process.setMotionParam(motionParam);
+                }
+
+                bool lastVariant = lastMode && v == variants - 1;
+                for ( int c=0; c<clusterModes.size(); c++ )
+                    run(out, process, frames, truth, syntheticParam.radius,
+                        modes[m], clusterModes[c], lastVariant && c == clusterModes.size() - 1);
+            }
+        }
+    }
+
+    out << "  ],\n";
+
+    {
+        QList<Process::Mode> bandModes;
+        bandModes << Process::ProcessColor << Process::ProcessMotion;
+
+        QList<int> threadCounts;
+        threadCounts << 1 << 2 << 4 << 8;
+
+        Process process(frameWidth, frameHeight);
+
+        out << "  \"threadScaling\": [\n";
+        for ( int m=0; m<bandModes.size(); m++ ) {
+            for ( int t=0; t<threadCounts.size(); t++ ) {
+                bool last = m == bandModes.size() - 1 && t == threadCounts.size() - 1;
+                runThreads(out, process, frames, bandModes[m], threadCounts[t], last);
+            }
+        }
+        out << "  ],\n";
+    }
+
+    {
+        Process process(frameWidth, frameHeight);
+        process.setThreadCount(threads);
+
+        out << "  \"colorPaths\": [\n";
+        runColorPath(out, process, frames, Process::ColorPathTable, false);
+        runColorPath(out, process, frames, Process::ColorPathSimd, true);
+        out << "  ],\n";
+    }
+
+    {
+        QList<int> tileRows;
+        tileRows << 0 << 16 << 64 << 256;
+
+        QList<int> threadCounts;
+        threadCounts << 1 << 2 << 4 << 8;
+
+        Process process(frameWidth, frameHeight);
+        Clustering::SimpleClusterParam param = process.getSimpleClusterParam();
+
+        QVector<Areas> reference;
+        findReference(process, frames, param, reference);
+
+        out << "  \"tileScaling\": [\n";
+        for ( int r=0; r<tileRows.size(); r++ ) {
+            for ( int t=0; t<threadCounts.size(); t++ ) {
+                bool last = r == tileRows.size() - 1 && t == threadCounts.size() - 1;
+                runTiles(out, process, frames, param, reference, tileRows[r], threadCounts[t], last);
+            }
+        }
+        out << "  ],\n";
+    }
+
+    if ( maxStreams > 0 ) {
+        out << "  \"scaling\": [\n";
+        for ( int n=1; n<=maxStreams; n++ )
+            runStreams(out, frames, n, n == maxStreams);
+        out << "  ],\n";
+    }
+
+    out << "  \"allocations\": " << FramePool::getAllocations() << ",\n"
+        << "  \"copies\": " << FramePool::getCopies() << "\n"
+        << "}\n";
+    out.flush();
+
+    frames.clear();
+    delete ring;
+
+    return 0;
+}
@@ -6,6 +6,8 @@
 #include <QDir>
 #include <QDebug>
 
+#include "process/clock.h"
+
 Scene::Scene()
 {
     qDebug() << "Constructor Begin: Scene";
@@ -25,11 +27,9 @@ Scene::Scene()
 
 void Scene::setProcessCount(int n)
 {
-    seqAreasVector.resize(n);
-    areasVector.resize(n);
+    resultVector.fill(0, n);
     widthVector.resize(n);
     heightVector.resize(n);
-    contoursVector.resize(n);
 }
 
 void Scene::setupEvent(void *view)
@@ -83,22 +83,34 @@ int &Scene::getHeight(int n)
     return heightVector[n];
 }
 
-Areas &Scene::getAreas(int n)
+const Areas &Scene::getAreas(int n)
+{
+    Q_ASSERT(n < resultVector.size() && resultVector[n]);
+    return resultVector[n]->areas;
+}
+
+const SeqAreas &Scene::getSeqAreas(int n)
+{
+    Q_ASSERT(n < resultVector.size() && resultVector[n]);
+    return resultVector[n]->seqAreas;
+}
+
+const Contours &Scene::getContours(int n)
 {
-    Q_ASSERT(n < areasVector.size());
-    return areasVector[n];
+    Q_ASSERT(n < resultVector.size() && resultVector[n]);
+    return resultVector[n]->contours;
 }
 
-SeqAreas &Scene::getSeqAreas(int n)
+qint64 Scene::getFrameTime(int n)
 {
-    Q_ASSERT(n < seqAreasVector.size());
-    return seqAreasVector[n];
+    Q_ASSERT(n < resultVector.size() && resultVector[n]);
+    return resultVector[n]->frame.getTime();
 }
 
-Contours &Scene::getContours(int n)
+int Scene::getFrameAge(int n)
 {
-    Q_ASSERT(n < contoursVector.size());
-    return contoursVector[n];
+    qint64 time = getFrameTime(n);
+    return time ? (Clock::now() - time) / 1000 : 0;
 }
 
 int Scene::time()
@@ -39,9 +39,15 @@ public:
     // Scene API: data from OpenCV
     int &getWidth (int n);
     int &getHeight(int n);
-    Areas &getAreas(int n);
-    SeqAreas &getSeqAreas(int n);
-    Contours &getContours(int n);
+    const Areas &getAreas(int n);
+    const SeqAreas &getSeqAreas(int n);
+    const Contours &getContours(int n);
+
+    // Scene API: время захвата кадра, по которому получены данные
+    // процесса n (мкс, часы Clock), и сколько прошло с захвата, мс.
+    // По ним можно поправить положение на задержку обработки
+    qint64 getFrameTime(int n);
+    int getFrameAge(int n);
 
     // Scene API: time
     int time();
@@ -60,9 +66,10 @@ public:
     void setProcessCount(int n);
     void setWidth (int n, int width ) {  widthVector[n] = width;  }
     void setHeight(int n, int height) { heightVector[n] = height; }
-    void setAreas(int n, Areas areas) { areasVector[n] = areas; }
-    void setSeqAreas(int n, SeqAreas seqAreas) { seqAreasVector[n] = seqAreas; }
-    void setContours(int n, Contours contours) { contoursVector[n] = contours; }
+
+    // Результат обработки не копируется: сцена читает его, пока
+    // Manager не передаст следующий
+    void setResult(int n, const ProcessResult *result) { resultVector[n] = result; }
 
     // Controls
     QWidget     *getWidget() { return widget; }
@@ -78,9 +85,7 @@ protected:
 private:
     QVector<int> widthVector;
     QVector<int> heightVector;
-    QVector<Areas> areasVector;
-    QVector<SeqAreas> seqAreasVector;
-    QVector<Contours> contoursVector;
+    QVector<const ProcessResult *> resultVector;
 
     bool firstPaint;
 
@@ -2,6 +2,8 @@
 
 #include <QDebug>
 
+#include "process/tracer.h"
+
 
 View::View(QGLFormat &format) :
     QGLWidget(format)
@@ -11,6 +13,7 @@ View::View(QGLFormat &format) :
     differenceTimePaint = 0;
 
     scene = 0;
+    frame = 0;
     fpsRest = 0;
     fpsFrames = 0;
     fpsResult = 0;
@@ -94,6 +97,10 @@ void View::resizeGL(int width, int height)
 
 void View::paintGL()
 {
+    // paintGL вызывается и из updateGL(), и самим Qt (изменение
+    // размера, перекрытие окна), в трассу попадает каждая отрисовка
+    TraceSpan span("paint", frame);
+
     prevTimePaint = timePaint;
     timePaint = timeScene.elapsed();
     differenceTimePaint = timePaint - prevTimePaint;
@@ -20,6 +20,9 @@ public:
 
     void addImage(Image *image);
 
+    // Номер кадра, результат которого сейчас рисуется (для трассировки)
+    void setFrame(unsigned int frame) { this->frame = frame; }
+
 protected:
     void initializeGL();
     void resizeGL(int width, int height);
@@ -44,6 +47,8 @@ private:
     int fpsResult;
 
     QVector<Image *> images;
+
+    unsigned int frame;
 };
 
 #endif // VIEW_H
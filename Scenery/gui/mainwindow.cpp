@@ -23,11 +23,22 @@ MainWindow::MainWindow(Manager *manager, QWidget *parent) :
         ui->scenesStackedWidget->addWidget(scene->getWidget());
     }
 
-    processWindow = new ProcessWindow(manager->getProcesses().at(0), "process.ini");
+    // У каждого процесса свое окно и свой файл параметров
+    for(int i=0; i<manager->getProcesses().size(); i++) {
+        QString file = i == 0 ? "process.ini" : QString("process%1.ini").arg(i+1);
+        processWindows.append(new ProcessWindow(manager->getProcesses().at(i), file));
+        ui->processComboBox->addItem(QString("Process %1").arg(i+1));
+    }
+    ui->processComboBox->setVisible(processWindows.size() > 1);
+
+    ui->inputsTable->setRowCount(manager->getInputs().size());
+    ui->processesTable->setRowCount(manager->getProcesses().size());
+    processedPrev.fill(0, manager->getProcesses().size());
+    processedTime.start();
 
     connect(ui->scenesComboBox, SIGNAL(activated(int)), SLOT(changeScene(int)));
     connect(ui->actionFullScreen, SIGNAL(toggled(bool)), SLOT(setFullScreen(bool)));
-    connect(ui->processParamButton, SIGNAL(clicked()), processWindow, SLOT(show()));
+    connect(ui->processParamButton, SIGNAL(clicked()), SLOT(slotProcessParam()));
     connect(ui->saveStateButton, SIGNAL(clicked()), SLOT(slotSaveControls()));
     connect(ui->loadStateButton, SIGNAL(clicked()), SLOT(slotLoadControls()));
     connect(ui->addStateButton, SIGNAL(clicked()), SLOT(slotAddState()));
@@ -43,6 +54,8 @@ MainWindow::MainWindow(Manager *manager, QWidget *parent) :
 
 MainWindow::~MainWindow()
 {
+    for(int i=0; i<processWindows.size(); i++)
+        delete processWindows[i];
     delete ui;
 }
 
@@ -115,7 +128,70 @@ void MainWindow::closeEvent(QCloseEvent *)
 void MainWindow::timerEvent(QTimerEvent *)
 {
     ui->graphicFPSLabel->setNum(manager->getView()->getFPS());
-    ui->input1FPSLabel->setNum(manager->getInputs().at(0)->getFPS());
+
+    updateInputsTable();
+    updateProcessesTable();
+}
+
+void MainWindow::updateInputsTable()
+{
+    Inputs &inputs = manager->getInputs();
+
+    for(int i=0; i<inputs.size(); i++) {
+        FrameStats::Stats stats = inputs[i]->getFrameStats().getStats();
+
+        QStringList row;
+        row << QString::number(i+1)
+            << QString::number(stats.fps, 'f', 1)
+            << QString::number(stats.mean / 1000.0, 'f', 1)
+            << QString::number(stats.jitter / 1000.0, 'f', 2)
+            << QString::number(stats.max / 1000.0, 'f', 1)
+            << QString::number(stats.gaps)
+            << QString::number(inputs[i]->getRing()->getDropped());
+
+        setTableRow(ui->inputsTable, i, row);
+    }
+}
+
+void MainWindow::updateProcessesTable()
+{
+    Processes &processes = manager->getProcesses();
+
+    int elapsed = processedTime.restart();
+    if (elapsed <= 0)
+        return;
+
+    for(int i=0; i<processes.size(); i++) {
+        Process *process = processes[i];
+
+        unsigned int processed = process->getProcessed();
+        double fps = (processed - processedPrev[i]) * 1000.0 / elapsed;
+        processedPrev[i] = processed;
+
+        StageTimer::Stats latency = process->getLatencyTimer().getStats();
+
+        QStringList row;
+        row << QString::number(i+1)
+            << QString::number(manager->getProcessInput(i)+1)
+            << QString::number(fps, 'f', 1)
+            << QString::number(latency.p50 / 1000.0, 'f', 1)
+            << QString::number(latency.p95 / 1000.0, 'f', 1)
+            << QString::number(process->getSkipped());
+
+        setTableRow(ui->processesTable, i, row);
+    }
+}
+
+void MainWindow::setTableRow(QTableWidget *table, int row, const QStringList &values)
+{
+    for(int j=0; j<values.size(); j++) {
+        QTableWidgetItem *item = table->item(row, j);
+        if (!item) {
+            item = new QTableWidgetItem();
+            table->setItem(row, j, item);
+        }
+        item->setText(values[j]);
+    }
 }
 
 void MainWindow::loadSettings()
@@ -195,6 +271,15 @@ void MainWindow::setFullScreen(bool full)
         manager->getView()->showNormal();
 }
 
+void MainWindow::slotProcessParam()
+{
+    int n = ui->processComboBox->currentIndex();
+    if (n < 0 || n >= processWindows.size())
+        n = 0;
+
+    processWindows[n]->show();
+}
+
 void MainWindow::slotSaveControls()
 {
     saveControls(manager->getCurScene(), "controls.ini", curState,
@@ -3,6 +3,7 @@
 
 #include <QMainWindow>
 #include <QTableWidget>
+#include <QTime>
 
 #include "manager.h"
 #include "processwindow.h"
@@ -30,9 +31,20 @@ protected:
 private:
     Ui::MainWindow *ui;
     Manager *manager;
-    ProcessWindow *processWindow;
+    QVector<ProcessWindow *> processWindows;
     int curState;
 
+    // Количество результатов каждого процесса на прошлом обновлении,
+    // для подсчета FPS
+    QVector<unsigned int> processedPrev;
+    QTime processedTime;
+
+    void updateInputsTable();
+    void updateProcessesTable();
+
+    // Записать строку таблицы, создавая ячейки при первом обращении
+    void setTableRow(QTableWidget *table, int row, const QStringList &values);
+
     void loadSettings();
     void addState(QString name);
     void delState(int n);
@@ -43,6 +55,7 @@ public slots:
     void changeState(int n);
 
     void setFullScreen(bool full);
+    void slotProcessParam();
     void slotSaveControls();
     void slotLoadControls();
     void slotAddState();
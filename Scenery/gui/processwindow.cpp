@@ -1,7 +1,9 @@
 #include "processwindow.h"
 #include "ui_processwindow.h"
+#include "process/tracer.h"
 #include <QSettings>
 #include <QDir>
+#include <QFileDialog>
 #include <QDebug>
 
 ProcessWindow::ProcessWindow(Process *process, QString file, QWidget *parent) :
@@ -43,9 +45,17 @@ ProcessWindow::ProcessWindow(Process *process, QString file, QWidget *parent) :
             ui->colorVmaxLabel,  SLOT(setNum(int)));
 
     // Motion
+    QStringList motionModes;
+    motionModes << "Frame difference" << "Background";
+    ui->motionModeBox->addItems(motionModes);
+    connect(ui->motionModeBox, SIGNAL(activated(int)), SLOT(slotMotionParam()));
+
     connect(ui->motionSensitivitySlider, SIGNAL(valueChanged(int)), SLOT(slotMotionParam()));
     connect(ui->motionSensitivitySlider, SIGNAL(valueChanged(int)),
             ui->motionSensitivityLabel, SLOT(setNum(int)));
+    connect(ui->motionLearnSlider, SIGNAL(valueChanged(int)), SLOT(slotMotionParam()));
+    connect(ui->motionLearnSlider, SIGNAL(valueChanged(int)),
+            ui->motionLearnLabel, SLOT(setNum(int)));
 
     // Haar
     QDir dir;
@@ -140,6 +150,19 @@ ProcessWindow::ProcessWindow(Process *process, QString file, QWidget *parent) :
     connect(ui->transform2DDeepHyDoubleSpin, SIGNAL(valueChanged(double)), SLOT(slotTransform2D()));
     connect(ui->transform2DDeepHsDoubleSpin, SIGNAL(valueChanged(double)), SLOT(slotTransform2D()));
 
+    // Timing
+    QStringList timingColumns;
+    timingColumns << "Count" << "p50, us" << "p95, us" << "p99, us" << "max, us";
+    ui->timingTable->setColumnCount(timingColumns.size());
+    ui->timingTable->setHorizontalHeaderLabels(timingColumns);
+
+    connect(ui->timingCsvButton, SIGNAL(clicked()), SLOT(slotTimingCsv()));
+    connect(ui->timingJsonButton, SIGNAL(clicked()), SLOT(slotTimingJson()));
+    connect(&timingTimer, SIGNAL(timeout()), SLOT(slotTiming()));
+    connect(ui->traceCheck, SIGNAL(toggled(bool)), SLOT(slotTrace(bool)));
+    connect(ui->traceSaveButton, SIGNAL(clicked()), SLOT(slotTraceSave()));
+    timingTimer.start(500);
+
     loadParam();
 }
 
@@ -196,7 +219,9 @@ void ProcessWindow::loadParam()
         settings.endGroup();
 
         settings.beginGroup("/Motion");
+            ui->motionModeBox->setCurrentIndex( settings.value("/Model").toString() == "Background" ? 1 : 0 );
             ui->motionSensitivitySlider->setValue( settings.value("/Sensitiviy").toInt() );
+            ui->motionLearnSlider->setValue( settings.value("/Learn", 5).toInt() );
             slotMotionParam();
         settings.endGroup();
 
@@ -300,7 +325,9 @@ void ProcessWindow::saveParam()
         settings.endGroup();
 
         settings.beginGroup("/Motion");
+            settings.setValue("/Model", ui->motionModeBox->currentIndex() == 1 ? "Background" : "FrameDiff" );
             settings.setValue("/Sensitiviy", ui->motionSensitivitySlider->value() );
+            settings.setValue("/Learn", ui->motionLearnSlider->value() );
         settings.endGroup();
 
         settings.beginGroup("/Haar");
@@ -406,7 +433,10 @@ void ProcessWindow::slotColorRangeParam()
 void ProcessWindow::slotMotionParam()
 {
     Process::MotionParam param;
+    param.mode = ui->motionModeBox->currentIndex() == 1 ? Process::MotionBackground
+                                                        : Process::MotionFrameDiff;
     param.sensitivity = ui->motionSensitivitySlider->value();
+    param.learnShift = ui->motionLearnSlider->value();
     process->setMotionParam(param);
 }
 
@@ -466,6 +496,7 @@ void ProcessWindow::slotClusterSimple()
     param.distance = ui->clusterSimpleDistanceSpin->value();
     param.limit = ui->clusterSimpleLimitSpin->value();
     param.density = ui->clusterSimpleDensitySpin->value();
+    param.tileRows = 0;
     process->setSimpleClusterParam(param);
 }
 
@@ -508,3 +539,61 @@ void ProcessWindow::slotTransform2D()
     param.deepHs = ui->transform2DDeepHsDoubleSpin->value();
     process->setTransform2DParam(param);
 }
+
+void ProcessWindow::slotTiming()
+{
+    if ( !isVisible() || ui->tabWidget->currentWidget() != ui->timing )
+        return;
+
+    QList<StageTimer *> timers = StageTimer::getTimers();
+    ui->timingTable->setRowCount(timers.size());
+
+    for ( int i=0; i<timers.size(); i++ ) {
+        StageTimer::Stats stats = timers[i]->getStats();
+
+        QStringList values;
+        values << QString::number(stats.count)
+               << QString::number(stats.p50)
+               << QString::number(stats.p95)
+               << QString::number(stats.p99)
+               << QString::number(stats.max);
+
+        ui->timingTable->setVerticalHeaderItem(i, new QTableWidgetItem(timers[i]->getName()));
+        for ( int j=0; j<values.size(); j++ )
+            ui->timingTable->setItem(i, j, new QTableWidgetItem(values[j]));
+    }
+}
+
+void ProcessWindow::slotTimingCsv()
+{
+    QString fileName = QFileDialog::getSaveFileName(this, "Save timing", "timing.csv", "CSV (*.csv)");
+    if ( !fileName.isEmpty() )
+        StageTimer::saveCsv(fileName);
+}
+
+void ProcessWindow::slotTimingJson()
+{
+    QString fileName = QFileDialog::getSaveFileName(this, "Save timing", "timing.json", "JSON (*.json)");
+    if ( !fileName.isEmpty() )
+        StageTimer::saveJson(fileName);
+}
+
+void ProcessWindow::slotTrace(bool enabled)
+{
+    // Новая запись начинается с чистых буферов
+    if (enabled)
+        Tracer::clear();
+
+    Tracer::setEnabled(enabled);
+}
+
+void ProcessWindow::slotTraceSave()
+{
+    QString fileName = QFileDialog::getSaveFileName(this, "Save trace", "trace.json", "Trace (*.json)");
+    if ( fileName.isEmpty() )
+        return;
+
+    Tracer::save(fileName);
+    if ( Tracer::getDropped() )
+        qDebug() << "Trace: dropped events:" << Tracer::getDropped();
+}
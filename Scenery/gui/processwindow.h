@@ -3,6 +3,7 @@
 
 #include "process/process.h"
 #include <QWidget>
+#include <QTimer>
 
 namespace Ui {
 class ProcessWindow;
@@ -24,6 +25,8 @@ private:
     Process *process;
     QString file;
 
+    QTimer timingTimer;
+
 public slots:
     void loadParam();
     void saveParam();
@@ -43,6 +46,12 @@ public slots:
     void slotFilterSeqArea();
     void slotTransform2D();
 
+    void slotTiming();
+    void slotTimingCsv();
+    void slotTimingJson();
+    void slotTrace(bool enabled);
+    void slotTraceSave();
+
 };
 
 #endif // PROCESSWINDOW_H
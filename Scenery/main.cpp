@@ -1,15 +1,93 @@
 #include <QApplication>
+#include <QStringList>
+#include <QTimer>
 
 #include "manager.h"
 #include "gui/mainwindow.h"
+#include "process/logsink.h"
+#include "process/sharedsink.h"
+#include "process/oscsink.h"
+
+// Получатели результатов, в любом режиме:
+//   --log file     текстовый журнал ("-" - стандартный вывод)
+//   --shared key   кольцо треков в разделяемой памяти (trackformat.h)
+//   --udp port     TUIO 2Dcur на 127.0.0.1 (--udp-host другой адрес)
+// Для нескольких процессов журнал процесса n пишется в file.n,
+// ключ разделяемой памяти - key.n, порт - port + n - 1
+static void addSinks(Manager &manager, const QStringList &args)
+{
+    QString log;
+    QString shared;
+    QString udpHost = "127.0.0.1";
+    int udpPort = 0;
+
+    for ( int i=1; i<args.size(); i++ ) {
+        if ( args[i] == "--log" && i+1 < args.size() )
+            log = args[++i];
+        else if ( args[i] == "--shared" && i+1 < args.size() )
+            shared = args[++i];
+        else if ( args[i] == "--udp" && i+1 < args.size() )
+            udpPort = args[++i].toInt();
+        else if ( args[i] == "--udp-host" && i+1 < args.size() )
+            udpHost = args[++i];
+    }
+
+    int count = manager.getProcesses().size();
+    for ( int i=0; i<count; i++ ) {
+        QString suffix = count == 1 ? "" : QString(".%1").arg(i+1);
+
+        // Стандартный вывод получает только первый процесс
+        if ( !log.isEmpty() && (log != "-" || i == 0) )
+            manager.addSink(i, new LogSink(log == "-" ? log : log + suffix));
+
+        if ( !shared.isEmpty() )
+            manager.addSink(i, new SharedSink(shared + suffix));
+
+        if ( udpPort > 0 )
+            manager.addSink(i, new OscSink(QHostAddress(udpHost), udpPort + i));
+    }
+}
+
+// Без окон: захват, обработка и получатели результатов
+//   Scenery --headless [--duration seconds] [получатели]
+static int runHeadless(QApplication &a)
+{
+    QStringList args = a.arguments();
+    int duration = 0;
+
+    for ( int i=1; i<args.size(); i++ ) {
+        if ( args[i] == "--duration" && i+1 < args.size() )
+            duration = args[++i].toInt();
+    }
+
+    Manager manager(true);
+    addSinks(manager, args);
+    manager.start();
+
+    if ( duration > 0 )
+        QTimer::singleShot(duration * 1000, &a, SLOT(quit()));
+
+    return a.exec();
+}
 
 int main(int argc, char *argv[])
 {
-    QApplication a(argc, argv);
+    bool headless = false;
+    for ( int i=1; i<argc; i++ )
+        if ( QString(argv[i]) == "--headless" )
+            headless = true;
+
+    QApplication a(argc, argv, !headless);
     QCoreApplication::setOrganizationName("Turlicht");
     QCoreApplication::setApplicationName("Scenery");
+
+    if (headless)
+        return runHeadless(a);
+
     Manager manager;
     MainWindow mainWindow(&manager);
+    addSinks(manager, a.arguments());
     mainWindow.show();
+    manager.start();
     return a.exec();
 }
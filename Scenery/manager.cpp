@@ -4,25 +4,38 @@
 #include <QDir>
 #include <QEvent>
 #include <QApplication>
+#include <QSettings>
 
-Manager::Manager()
+#include <stdio.h>
+
+#include "process/clock.h"
+#include "process/tracer.h"
+
+Manager::Manager(bool headless) :
+    publishTimer("publish"),
+    paintTimer("paint")
 {
     qDebug() << "Constructor Begin: Manager";
+    Tracer::setThreadName(headless ? "main" : "gui");
+    this->headless = headless;
     isPlay = false;
+    curScene = 0;
+    view = 0;
+    debug = 0;
 
-    ProcessTools::initRGB2HSV();
-    int cameraWidth = 640;
-    int cameraHeight = 480;
+    ProcessTools::initRGB2HSV("rgb2hsv.cache");
+    createInputs("inputs.ini");
 
-    Input *input = new Input(Input::None, "", cameraWidth, cameraHeight);
-    //InputThread *input = new InputThread(InputThread::Video, "video/tesla.mp4");
-    //input->start();
-    inputs.append(input);
+    resultNumbers.fill(0, processes.size());
+    processedPrev.fill(0, processes.size());
 
-    Process *process = new Process(input->getWidth(), input->getHeigth());
-    processes.append(process);
+    if (headless) {
+        qDebug() << "Constructor End: Manager";
+        return;
+    }
 
-    debug = new DebugWindow("main", cameraWidth, cameraHeight);
+    debug = new DebugWindow("main", processes[0]->getWidth(), processes[0]->getHeight());
+    processes[0]->setPublishHitMask(true);
 
     scenes.append(new Skeleton());
     scenes.append(new Cage());
@@ -30,22 +43,16 @@ Manager::Manager()
     scenes.append(new Brush());
     scenes.append(new Inking());
 
+    // Результат процесса n попадает в слот n каждой сцены
+    for ( int i=0; i<scenes.size(); i++)
+        scenes[i]->setProcessCount(processes.size());
+
     QGLFormat format;
     format.setDoubleBuffer(false);
     view = new View(format);
     view->show();
     setScene(0);
 
-    firstInput = true;
-    firstDebug = true;
-    firstSetImage = true;
-    firstSetData = true;
-    firstProcess = true;
-    firstEndProcess = true;
-
-    qDebug() << "Input run";
-    input->start();
-    startTimer(17);
     qDebug() << "Constructor End: Manager";
 }
 
@@ -54,17 +61,25 @@ Manager::~Manager()
     qDebug() << "Destructor Begin: Manager";
 
     delete view;
+    delete debug;
 
+    // Обработка держит буферы очереди, поэтому останавливается первой
     for ( int i=0; i<processes.size(); i++){
+        processes[i]->stop();
         processes[i]->wait();
         delete processes[i];
     }
 
     for ( int i=0; i<inputs.size(); i++){
+        inputs[i]->stop();
         inputs[i]->wait();
         delete inputs[i];
     }
 
+    for ( int i=0; i<sinks.size(); i++){
+        delete sinks[i];
+    }
+
     for ( int i=0; i<scenes.size(); i++){
         delete scenes[i];
     }
@@ -72,15 +87,125 @@ Manager::~Manager()
     qDebug() << "Destructor End: Manager";
 }
 
+void Manager::createInputs(QString file)
+{
+    int cameraWidth = 640;
+    int cameraHeight = 480;
+
+    QSettings settings(file, QSettings::IniFormat);
+    int count = settings.beginReadArray("inputs");
+
+    // Имена таймеров и потоков различаются, только если их несколько
+    bool several = count > 1;
+
+    // Потоков на строки кадра для каждого процесса, 0 - автоматически
+    QVector<int> threads;
+
+    for ( int i=0; i<count; i++) {
+        settings.setArrayIndex(i);
+        QString device = settings.value("device", "none").toString();
+        QString name = settings.value("name", "").toString();
+        int width = settings.value("width", cameraWidth).toInt();
+        int height = settings.value("height", cameraHeight).toInt();
+        int processCount = qMax(settings.value("processes", 1).toInt(), 1);
+        int threadCount = qMax(settings.value("threads", 0).toInt(), 0);
+        QString record = settings.value("record", "").toString();
+        QString rate = settings.value("rate", "original").toString();
+
+        if ( processCount > 1 )
+            several = true;
+
+        Input::Device type = Input::None;
+        if ( device == "camera" )
+            type = Input::Camera;
+        else if ( device == "video" )
+            type = Input::Video;
+        else if ( device == "replay" )
+            type = Input::Replay;
+        else if ( device == "synthetic" )
+            type = Input::Synthetic;
+
+        Input *input = new Input(type, name, width, height, processCount);
+        if ( !record.isEmpty() )
+            input->setRecord(record);
+        if ( rate == "fast" )
+            input->setReplayRate(Input::ReplayFast);
+
+        if ( type == Input::Synthetic ) {
+            SyntheticScene::Param param = SyntheticScene::defaultParam();
+            param.blobs = settings.value("blobs", param.blobs).toInt();
+            param.radius = settings.value("radius", param.radius).toInt();
+            param.speed = settings.value("speed", param.speed).toDouble();
+            param.noise = settings.value("noise", param.noise).toInt();
+            param.occlusion = settings.value("occlusion", param.occlusion).toDouble();
+            param.seed = settings.value("seed", param.seed).toUInt();
+            input->setSyntheticParam(param);
+        }
+        if (several)
+            input->getCaptureTimer().setName( QString("capture%1").arg(i) );
+        inputs.append(input);
+
+        for ( int j=0; j<processCount; j++) {
+            Process *process = new Process(input->getWidth(), input->getHeigth());
+            process->setInput(input->getRing());
+            if (several)
+                process->setName( QString("process%1").arg(processes.size()) );
+            processes.append(process);
+            processInputs.append(i);
+            threads.append(threadCount);
+        }
+    }
+    settings.endArray();
+
+    if ( inputs.isEmpty() ) {
+        Input *input = new Input(Input::None, "", cameraWidth, cameraHeight);
+        //InputThread *input = new InputThread(InputThread::Video, "video/tesla.mp4");
+        inputs.append(input);
+
+        Process *process = new Process(input->getWidth(), input->getHeigth());
+        process->setInput(input->getRing());
+        processes.append(process);
+        processInputs.append(0);
+        threads.append(0);
+    }
+
+    // Свободные ядра делятся поровну: поток каждого процесса
+    // сам обрабатывает часть строк своего кадра
+    int autoThreads = qMax(1, QThread::idealThreadCount() / processes.size());
+    for ( int i=0; i<processes.size(); i++)
+        processes[i]->setThreadCount( threads[i] > 0 ? threads[i] : autoThreads );
+}
+
+void Manager::addSink(int n, ResultSink *sink)
+{
+    processes[n]->addSink(sink);
+    sinks.append(sink);
+}
+
+void Manager::start()
+{
+    qDebug() << "Input run";
+    for ( int i=0; i<inputs.size(); i++)
+        inputs[i]->start();
+    for ( int i=0; i<processes.size(); i++)
+        processes[i]->start();
+
+    processedTime.start();
+    startTimer(headless ? 1000 : 17);
+}
+
 void Manager::setScene(int n)
 {
     if ( !(n < scenes.size()) )
         return;
 
     curScene = n;
+    for ( int i=0; i<processes.size(); i++) {
+        scenes.at(n)->setResult(i, processes[i]->getResult());
+        scenes.at(n)->setWidth(i, processes[i]->getWidth());
+        scenes.at(n)->setHeight(i, processes[i]->getHeight());
+    }
     view->setScene(scenes.at(n));
-    scenes.at(n)->setWidth(0, processes[0]->getWidth());
-    scenes.at(n)->setHeight(0, processes[0]->getHeight());
 }
 
 void Manager::timerEvent(QTimerEvent *)
@@ -90,61 +215,68 @@ void Manager::timerEvent(QTimerEvent *)
 
 void Manager::step()
 {
-    if ( !inputs[0]->isRunning() ) {
+    if (headless) {
+        printStats();
+        return;
+    }
 
-        if (firstInput) {
-            qDebug() << "First Input";
-            firstInput = false;
-        }
+    // Захват и обработка работают в своих потоках постоянно,
+    // здесь только забираем готовые результаты
+    for ( int i=0; i<processes.size(); i++) {
+        if ( processes[i]->getResultNumber() == resultNumbers[i] )
+            continue;
 
-        // возвращается копия изображения
-        //
-        IplImage *frame = inputs[0]->getFrame();
+        qint64 publishStart = Clock::now();
 
-        if ( !processes[0]->isRunning() ) {
+        const ProcessResult *result = processes[i]->takeResult();
+        resultNumbers[i] = result->number;
 
-            if (firstDebug) {
-                qDebug() << "First Debug";
-                firstDebug = false;
-            }
+        // set process data in scene
+        scenes.at(curScene)->setResult(i, result);
 
-            debug->show(frame, processes[0]);
+        qint64 publishTime = Clock::now() - publishStart;
+        publishTimer.add(publishTime);
+        Tracer::complete("publish", publishStart, publishTime, resultNumbers[i]);
 
-            if (firstSetImage) {
-                qDebug() << "First Set Image";
-                firstSetImage = false;
-            }
+        // Окно отладки показывает только первый процесс
+        if ( i == 0 ) {
+            TraceSpan span("debug", resultNumbers[i]);
+            debug->show(result, processes[i]);
+        }
+    }
 
-            processes[0]->setImage(frame);
+    // Отрисовка идет синхронно внутри updateGL(), отрезок
+    // трассы пишет сам View::paintGL
+    qint64 paintStart = Clock::now();
+    view->setFrame(resultNumbers[0]);
+    view->updateGL();
 
-            if (firstSetData) {
-                qDebug() << "First Set Data";
-                firstSetData = false;
-            }
+    paintTimer.add(Clock::now() - paintStart);
+}
 
-            // set process data in scene
-            scenes.at(curScene)->setAreas(0, processes[0]->getAreas());
-            scenes.at(curScene)->setSeqAreas(0, processes[0]->getSeqAreas());
-            scenes.at(curScene)->setContours(0, processes[0]->getContours());
+void Manager::printStats()
+{
+    int elapsed = processedTime.restart();
+    if (elapsed <= 0)
+        return;
 
-            if (firstProcess) {
-                qDebug() << "First Process";
-                firstProcess = false;
-            }
+    for ( int i=0; i<inputs.size(); i++) {
+        FrameStats::Stats stats = inputs[i]->getFrameStats().getStats();
 
-            processes[0]->start();
+        fprintf(stderr, "input %d: %.1f fps, interval %.1f ms, jitter %.2f ms, lost %d, dropped %d\n",
+                i+1, stats.fps, stats.mean / 1000.0, stats.jitter / 1000.0,
+                stats.gaps, inputs[i]->getRing()->getDropped());
+    }
 
-            if (firstEndProcess) {
-                qDebug() << "First End Process";
-                firstEndProcess = false;
-            }
-        }
+    for ( int i=0; i<processes.size(); i++) {
+        unsigned int processed = processes[i]->getProcessed();
+        double fps = (processed - processedPrev[i]) * 1000.0 / elapsed;
+        processedPrev[i] = processed;
 
-        inputs[0]->start();
+        StageTimer::Stats latency = processes[i]->getLatencyTimer().getStats();
 
-        // set video stream in scene
+        fprintf(stderr, "process %d: %.1f fps, latency p50 %.1f ms, p95 %.1f ms, skipped %u\n",
+                i+1, fps, latency.p50 / 1000.0, latency.p95 / 1000.0,
+                processes[i]->getSkipped());
     }
-
-    view->updateGL();
 }
-
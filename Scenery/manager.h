@@ -1,4 +1,4 @@
-#ifndef MANAGER_H
+﻿#ifndef MANAGER_H
 #define MANAGER_H
 
 #include <QThread>
@@ -7,6 +7,8 @@
 
 #include "process/process.h"
 #include "process/input.h"
+#include "process/stagetimer.h"
+#include "process/resultsink.h"
 #include "process/gui/debugwindow.h"
 #include "graphics/view.h"
 
@@ -25,7 +27,9 @@ class Manager: public QObject
     Q_OBJECT
 
 public:
-    explicit Manager();
+    // headless - без окна OpenGL, окна отладки и сцен: только захват,
+    // обработка и получатели результатов
+    explicit Manager(bool headless = false);
     ~Manager();
 
     Processes &getProcesses() { return processes; }
@@ -34,6 +38,18 @@ public:
     Scene     *getCurScene()  { return scenes.at(curScene); }
     View      *getView()      { return view; }
 
+    // Номер входа, кадры которого обрабатывает процесс n
+    int getProcessInput(int n) { return processInputs.at(n); }
+
+    bool isHeadless() { return headless; }
+
+    // Получатель результатов процесса n. Manager удаляет его
+    // после остановки обработки. Добавлять до start()
+    void addSink(int n, ResultSink *sink);
+
+    // Запустить потоки захвата и обработки
+    void start();
+
     void setScene(int n);
     void setPlay(bool play) { isPlay = play; }
     void step();
@@ -43,6 +59,27 @@ private:
     Inputs inputs;
     Scenes scenes;
 
+    QVector<int> processInputs;
+    QVector<ResultSink *> sinks;
+
+    bool headless;
+
+    // Создает входы и процессы по файлу file, группа [inputs]:
+    //   size=2
+    //   1\device=camera    (none, camera, video, replay, synthetic)
+    //   1\name=0           (номер камеры, файл видео или записи)
+    //   1\width=640
+    //   1\height=480
+    //   1\processes=1      (потоков обработки на этот вход)
+    //   1\threads=0        (потоков на строки кадра в каждом процессе,
+    //                       0 - поровну делить ядра между процессами)
+    //   1\record=file      (записывать захваченные кадры)
+    //   1\rate=original    (скорость replay и synthetic: original, fast)
+    //   1\blobs=4          (параметры synthetic, см. SyntheticScene::Param:
+    //   1\radius=20         blobs, radius, speed, noise, occlusion, seed)
+    // Без файла создается один вход None с одним процессом
+    void createInputs(QString file);
+
     int curScene;
 
     View *view;
@@ -50,12 +87,17 @@ private:
 
     bool isPlay;
     void timerEvent(QTimerEvent *);
-    bool firstInput;
-    bool firstDebug;
-    bool firstProcess;
-    bool firstSetImage;
-    bool firstSetData;
-    bool firstEndProcess;
+
+    // Номер последнего результата каждого процесса, переданного в сцену
+    QVector<unsigned int> resultNumbers;
+
+    // Без окон раз в секунду печатает FPS и задержку каждого процесса
+    QVector<unsigned int> processedPrev;
+    QTime processedTime;
+    void printStats();
+
+    StageTimer publishTimer;    // Передача результата в сцену
+    StageTimer paintTimer;      // Отрисовка сцены
 signals:
 
 public slots:
@@ -0,0 +1,30 @@
+#include "background.h"
+
+BackgroundModel::BackgroundModel(int width, int height)
+{
+    this->width = width;
+    this->height = height;
+    step = (width + 15) & ~15;
+    empty = true;
+    planes.assign(ProcessSimd::PlaneCount * step * height, 0);
+}
+
+void BackgroundModel::reset(IplImage *image)
+{
+    for ( int y=0; y<height; y++ ) {
+        const uchar *img_ptr = (const uchar*) (image->imageData + y * image->widthStep);
+        unsigned short *model = row(y);
+
+        for ( int c=0; c<3; c++ ) {
+            unsigned short *mean = model + c * step;
+            for ( int x=0; x<width; x++ )
+                mean[x] = img_ptr[3*x+c] << 8;
+        }
+
+        unsigned short *deviation = model + ProcessSimd::PlaneDeviation * step;
+        for ( int x=0; x<width; x++ )
+            deviation[x] = 0;
+    }
+
+    empty = false;
+}
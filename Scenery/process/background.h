@@ -0,0 +1,43 @@
+#ifndef BACKGROUND_H
+#define BACKGROUND_H
+
+#include "processsimd.h"
+
+#include <opencv/cxcore.h>
+#include <vector>
+
+using std::vector;
+
+// Модель фона для поиска движения: для каждого пикселя средние
+// значения каналов и их среднее отклонение, которые медленно
+// подстраиваются под каждый новый кадр.
+//
+// Строка хранится отдельными плоскостями B, G, R и отклонения
+// (см. ProcessSimd::BackgroundPlane), поэтому векторный код
+// читает и пишет подряд идущие значения одного канала
+class BackgroundModel
+{
+public:
+    BackgroundModel(int width, int height);
+
+    int getStep() { return step; }
+
+    // Модель еще не начата или сброшена
+    bool isEmpty() { return empty; }
+    void clear() { empty = true; }
+
+    // Начать модель с кадра image: средние равны его пикселям
+    void reset(IplImage *image);
+
+    // Плоскости строки y, каждая по getStep() значений
+    unsigned short *row(int y) { return &planes[y * ProcessSimd::PlaneCount * step]; }
+
+private:
+    int width;
+    int height;
+    int step;       // Ширина плоскости, кратная 16
+    bool empty;
+    vector<unsigned short> planes;
+};
+
+#endif // BACKGROUND_H
@@ -0,0 +1,18 @@
+#include "clock.h"
+
+#include <QElapsedTimer>
+
+// Запускается при загрузке программы, до создания потоков
+static QElapsedTimer startTimer()
+{
+    QElapsedTimer timer;
+    timer.start();
+    return timer;
+}
+
+static QElapsedTimer timer = startTimer();
+
+qint64 Clock::now()
+{
+    return timer.nsecsElapsed() / 1000;
+}
@@ -0,0 +1,14 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <QtGlobal>
+
+// Монотонные часы, общие для всех потоков обработки.
+// Время в микросекундах от запуска программы
+class Clock
+{
+public:
+    static qint64 now();
+};
+
+#endif // CLOCK_H
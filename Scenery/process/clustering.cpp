@@ -1,24 +1,30 @@
 #include "clustering.h"
 #include <QDebug>
+#include <math.h>
 
 Clustering::Clustering()
 {
-    firstArea = NULL;
-
     clusterMode = ClusterNone;
 
     simpleClusterParam.distance = 1;
     simpleClusterParam.limit = 5;
     simpleClusterParam.density = 0;
+    simpleClusterParam.tileRows = 0;
 
     tableClusterParam.cellHeight = 5;
     tableClusterParam.cellWidth = 5;
     tableClusterParam.density = 50;
+
+    integralWidth = 0;
+
+    threadPool = 0;
+    tileCount = 0;
+    tileHitImage = 0;
+    tileHitMask = 0;
 }
 
 Clustering::~Clustering()
 {
-    void clearCvAreas();
 }
 
 void Clustering::findClusters(IplImage *hit, Areas &areas)
@@ -35,10 +41,25 @@ void Clustering::findClusters(IplImage *hit, Areas &areas)
     }
 }
 
+void Clustering::findClusters(HitMask &hit, Areas &areas)
+{
+    switch(clusterMode) {
+    case ClusterNone:
+        break;
+    case ClusterSimple:
+        simpleClustering(hit, areas);
+        break;
+    case ClusterTable:
+        tableClustering(hit, areas);
+        break;
+    }
+}
+
 void Clustering::setSimpleClusterParam(Clustering::SimpleClusterParam param)
 {
     simpleClusterParam = param;
     if ( simpleClusterParam.distance < 1 ) simpleClusterParam.distance = 1;
+    if ( simpleClusterParam.tileRows < 0 ) simpleClusterParam.tileRows = 0;
 }
 
 void Clustering::setTableClusterParam(Clustering::TableClusterParam param)
@@ -52,214 +73,435 @@ void Clustering::simpleClustering(IplImage *hit, Areas &areas)
 {
     // Очищаем список структур Area от предыдущего использования
     areas.clear();
-    clearCvAreas();
 
-    for( int y=0; y<hit->height; y++ ) {
+    findRuns(hit);
+
+    // Объединяем связанные отрезки в регионы
+    // и убираем не нужные
+    findRegions(areas);
+}
+
+void Clustering::simpleClustering(HitMask &hit, Areas &areas)
+{
+    areas.clear();
+    findRuns(hit);
+    findRegions(areas);
+}
+
+void Clustering::findRuns(IplImage *hit)
+{
+    tileHitImage = hit;
+    tileHitMask = 0;
+    findRuns(hit->height);
+}
+
+void Clustering::findRuns(HitMask &hit)
+{
+    tileHitImage = 0;
+    tileHitMask = &hit;
+    findRuns(hit.getHeight());
+}
+
+void Clustering::findRuns(int height)
+{
+    int threads = threadPool ? threadPool->getThreadCount() : 1;
+    int tileRows = simpleClusterParam.tileRows;
+    if ( tileRows <= 0 )
+        tileRows = (height + threads - 1) / threads;
+
+    tileCount = (height + tileRows - 1) / tileRows;
+    if ( (int)tiles.size() < tileCount )
+        tiles.resize(tileCount);
+
+    for ( int t=0; t<tileCount; t++ ) {
+        tiles[t].y0 = t * tileRows;
+        tiles[t].y1 = qMin(height, (t+1) * tileRows);
+    }
+
+    if ( threadPool && tileCount > 1 )
+        threadPool->parallelFor(tileCount, this, &Clustering::findTileRuns);
+    else
+        findTileRuns(0, tileCount, 0);
+
+    mergeTiles(height);
+}
+
+void Clustering::findTileRuns(int begin, int end, int thread)
+{
+    Q_UNUSED(thread);
+
+    for ( int t=begin; t<end; t++ ) {
+        if (tileHitMask)
+            findRuns(*tileHitMask, tiles[t]);
+        else
+            findRuns(tileHitImage, tiles[t]);
+    }
+}
+
+void Clustering::findRuns(IplImage *hit, Tile &tile)
+{
+    tile.runs.clear();
+    tile.rowRuns.resize(tile.y1 - tile.y0 + 1);
+
+    for( int y=tile.y0; y<tile.y1; y++ ) {
+
+        tile.rowRuns[y - tile.y0] = tile.runs.size();
 
         // Получаем указатели на начало строки 'y'
         uchar* hit_ptr = (uchar*) (hit->imageData + y * hit->widthStep);
 
-        for( int x=0; x<hit->width; x++ ) {
-            if ( hit_ptr[x] )
-            {
-                findAreas(x, y);
+        int x = 0;
+        while ( x < hit->width ) {
+            if ( !hit_ptr[x] ) {
+                x++;
+                continue;
             }
 
+            int x1 = x;
+            while ( x < hit->width && hit_ptr[x] )
+                x++;
+            addRun(tile, y, x1, x - 1);
         }
+
+        linkRuns(tile, y);
     }
 
-    // Объединяем рядом стоящие регионы
-    // и убираем не нужные
-    filterAreas(areas);
+    tile.rowRuns[tile.y1 - tile.y0] = tile.runs.size();
 }
 
-void Clustering::findAreas(int x, int y)
+void Clustering::findRuns(HitMask &hit, Tile &tile)
 {
-    CvArea *a = firstArea;
+    tile.runs.clear();
+    tile.rowRuns.resize(tile.y1 - tile.y0 + 1);
 
-    // проверяем все регионы, пока не найдем подходящий
-    while ( a!=NULL ) {
+    for( int y=tile.y0; y<tile.y1; y++ ) {
 
-        // Проверка попадания текущей точки в существующий регион с учетом simpleClusterParam.distance
-        if ( x >= a->pt1.x - simpleClusterParam.distance - 1 && x <= a->pt2.x + simpleClusterParam.distance + 1 &&
-             y >= a->pt1.y - simpleClusterParam.distance - 1 && y <= a->pt2.y + simpleClusterParam.distance + 1 )
-        {
-            a->n++;
-            if (x < a->pt1.x) a->pt1.x = x;
-            else if (x > a->pt2.x) a->pt2.x = x;
+        tile.rowRuns[y - tile.y0] = tile.runs.size();
 
-            // Эта проверка не нужна, т.к. при последовательном
-            // обходе пикселей регионов выше y не существует
-            // if (y < a->pt1.y) a->pt1.y = y;
+        // Начало и конец отрезка ищутся сразу по 64 пикселя
+        int x = hit.nextSet(y, 0);
+        while ( x < hit.getWidth() ) {
+            int x2 = hit.nextClear(y, x);
+            addRun(tile, y, x, x2 - 1);
+            x = hit.nextSet(y, x2);
+        }
 
-            if (y > a->pt2.y) a->pt2.y = y;
+        linkRuns(tile, y);
+    }
 
-            return;
-        }
+    tile.rowRuns[tile.y1 - tile.y0] = tile.runs.size();
+}
 
-        a = a->next;
+void Clustering::mergeTiles(int height)
+{
+    // Одна полоса уже размечена целиком
+    if ( tileCount == 1 ) {
+        runs.swap(tiles[0].runs);
+        rowRuns.swap(tiles[0].rowRuns);
+        return;
     }
 
-    // Если подходящий регион не был найден,
-    // создаем новый регион
-    a = new CvArea;
-    a->n = 1;
-    a->pt1.x = x;
-    a->pt1.y = y;
-    a->pt2.x = x;
-    a->pt2.y = y;
-    a->next = firstArea;
-    firstArea = a;
+    runs.clear();
+    rowRuns.resize(height + 1);
+
+    for ( int t=0; t<tileCount; t++ ) {
+        Tile &tile = tiles[t];
+        int offset = runs.size();
+
+        for ( int y=tile.y0; y<tile.y1; y++ )
+            rowRuns[y] = offset + tile.rowRuns[y - tile.y0];
+
+        runs.insert(runs.end(), tile.runs.begin(), tile.runs.end());
+        for ( unsigned int i=offset; i<runs.size(); i++ )
+            runs[i].parent += offset;
+    }
+
+    rowRuns[height] = runs.size();
+
+    // Внутри полосы строки уже связаны с предыдущими d строками.
+    // Остались первые d строк каждой полосы и строки выше ее начала
+    int d = simpleClusterParam.distance + 1;
+
+    for ( int t=1; t<tileCount; t++ ) {
+        int y0 = tiles[t].y0;
+
+        for ( int y=y0; y<y0+d && y<tiles[t].y1; y++ ) {
+            for ( int k=y-y0+1; k<=d && k<=y; k++ )
+                linkRows(runs, rowRuns[y], rowRuns[y+1], rowRuns[y-k], rowRuns[y-k+1]);
+        }
+    }
 }
 
-void Clustering::filterAreas(Areas &areas)
+void Clustering::addRun(Tile &tile, int y, int x1, int x2)
 {
-    // Объединяем все регионы, которые находятся в пределах range
-    CvArea *a1 = firstArea;
-    while (a1!=NULL) {
-        CvArea *a2 = firstArea;
-        while (a2!=NULL) {
-            bool isFound = false;
-
-            if ( a1!=a2 && a1->n > 0 && a2->n > 0) {
-                if ( a2->pt1.x >= a1->pt1.x - simpleClusterParam.distance - 1 &&
-                     a2->pt1.x <= a1->pt2.x + simpleClusterParam.distance + 1 &&
-                     a2->pt2.y >= a1->pt1.y - simpleClusterParam.distance - 1 &&
-                     a2->pt2.y <= a1->pt2.y + simpleClusterParam.distance + 1)
-                {
-                    a1->n+=a2->n;
-
-                    if ( a2->pt2.x > a1->pt2.x ) a1->pt2.x = a2->pt2.x;
-                    if ( a2->pt1.y < a1->pt1.y ) a1->pt1.y = a2->pt1.y;
-
-                    a2->n = 0;
-                    isFound = true;
-                }
-                if ( a2->pt2.x >= a1->pt1.x - simpleClusterParam.distance - 1 &&
-                     a2->pt2.x <= a1->pt2.x + simpleClusterParam.distance + 1 &&
-                     a2->pt2.y >= a1->pt1.y - simpleClusterParam.distance - 1 &&
-                     a2->pt2.y <= a1->pt2.y + simpleClusterParam.distance + 1)
-                {
-                    a1->n+=a2->n;
-
-                    if ( a2->pt1.x < a1->pt1.x ) a1->pt1.x = a2->pt1.x;
-                    if ( a2->pt1.y < a1->pt1.y ) a1->pt1.y = a2->pt1.y;
-
-                    a2->n = 0;
-                    isFound = true;
-                }
-
-                if (a2->pt1.x >= a1->pt1.x && a2->pt2.x <= a1->pt2.x &&
-                    a2->pt1.y >+ a1->pt1.y && a2->pt1.y <= a1->pt2.y)
-                {
-                    a1->n+=a2->n;
-
-                    if (a2->pt2.y > a1->pt2.y) a1->pt2.y = a2->pt2.y;
-
-                    a2->n = 0;
-                    isFound = true;
-                }
+    // Точки и регионы на расстоянии до distance + 1 пикселя
+    // образуют один регион
+    int d = simpleClusterParam.distance + 1;
+
+    Run run;
+    run.y = y;
+    run.x1 = x1;
+    run.x2 = x2;
+    run.parent = tile.runs.size();
+    tile.runs.push_back(run);
+
+    // Соседний отрезок в этой же строке
+    vector<Run> &runs = tile.runs;
+    int i = runs.size() - 1;
+    if ( i > tile.rowRuns[y - tile.y0] && runs[i].x1 - runs[i-1].x2 <= d )
+        unite(runs, i-1, i);
+}
 
+void Clustering::linkRuns(Tile &tile, int y)
+{
+    int d = simpleClusterParam.distance + 1;
+    int row = y - tile.y0;
+    int rowEnd = tile.runs.size();
 
-            }
+    // Отрезки предыдущих d строк этой полосы
+    for ( int k=1; k<=d && k<=row; k++ )
+        linkRows(tile.runs, tile.rowRuns[row], rowEnd, tile.rowRuns[row-k], tile.rowRuns[row-k+1]);
+}
 
-            if (isFound) {
-                // Начнем проверку заново
-                a2 = firstArea;
-            }
-            else {
-                a2 = a2->next;
-            }
+void Clustering::linkRows(vector<Run> &runs, int a, int aEnd, int b, int bEnd)
+{
+    int d = simpleClusterParam.distance + 1;
+
+    // Отрезки в строке упорядочены по x, поэтому
+    // достаточно одного прохода по каждой строке
+    int j = b;
+    for ( int i=a; i<aEnd; i++ ) {
+        while ( j < bEnd && runs[j].x2 + d < runs[i].x1 )
+            j++;
+
+        for ( int m=j; m<bEnd && runs[m].x1 <= runs[i].x2 + d; m++ )
+            unite(runs, m, i);
+    }
+}
 
+void Clustering::findRegions(Areas &areas)
+{
+    regions.clear();
+    runRegion.assign(runs.size(), -1);
+
+    for ( unsigned int i=0; i<runs.size(); i++ ) {
+        Run &run = runs[i];
+        int root = findRoot(runs, i);
+
+        if ( runRegion[root] < 0 ) {
+            // Регионы нумеруются в порядке появления их первого отрезка
+            runRegion[root] = regions.size();
+
+            Region region;
+            region.pt1 = cvPoint(run.x1, run.y);
+            region.pt2 = cvPoint(run.x2, run.y);
+            region.n = 0;
+            region.m10 = region.m01 = 0;
+            region.m20 = region.m11 = region.m02 = 0;
+            regions.push_back(region);
         }
-        a1 = a1->next;
+
+        Region &region = regions[runRegion[root]];
+        region.n += run.x2 - run.x1 + 1;
+        if (run.x1 < region.pt1.x) region.pt1.x = run.x1;
+        if (run.x2 > region.pt2.x) region.pt2.x = run.x2;
+        if (run.y  > region.pt2.y) region.pt2.y = run.y;
+        addMoments(region, run);
     }
 
-    // Убираем пустые и неподходящие регионы
-    CvArea *a = firstArea;
-    CvArea *newAreaFirst = NULL;
-    while (a!=NULL) {
+    // Прежний simpleClustering добавлял новые регионы в начало списка,
+    // и Areas шли от последнего найденного к первому. findSeqAreas
+    // назначает свободные последовательности в порядке Areas,
+    // поэтому порядок сохраняется
+    for ( int i=regions.size()-1; i>=0; i-- ) {
+        Region &region = regions[i];
 
         // Фильтрация региона на количество точек и плотность точек
-        if ( a->n < simpleClusterParam.limit ) {
-            a->n=0;
-        }
-        else {
-            // Подсчет плотности найденных точек в процентах
-            a->p = int( double(a->n) / double((a->pt2.x - a->pt1.x + 1) * (a->pt2.y - a->pt1.y + 1)) * 100);
-
-            // Здесь нужно учесть ситуацию, когда нужная нам область была объединена
-            // с большой областью, в которой низкая плотность точек. Тогда у нужной нам область
-            // будет низкая плотность точек и эта область исчезнет. Нужно дописать
-            // алгоритм, находящий в этом регионе нужную плотность точек
-            if (a->p < simpleClusterParam.density) a->n=0;
-        }
+        if ( region.n < simpleClusterParam.limit )
+            continue;
+
+        // Подсчет плотности найденных точек в процентах
+        int p = int( double(region.n) / double((region.pt2.x - region.pt1.x + 1) *
+                                               (region.pt2.y - region.pt1.y + 1)) * 100);
+        if ( p < simpleClusterParam.density )
+            continue;
+
+        Area area;
+        area.ptReal[0] = region.pt1.x + (region.pt2.x - region.pt1.x)/2;
+        area.ptReal[1] = region.pt1.y + (region.pt2.y - region.pt1.y)/2;
+        area.widthReal  = region.pt2.x - region.pt1.x;
+        area.heightReal = region.pt2.y - region.pt1.y;
+        setMoments(area, region);
+        areas.push_back(area);
+    }
+}
 
-        // Создаем новый список регионов, оставляя только нужные
-        CvArea *areaTemp = a;
-        a = a->next;
-
-        if (areaTemp->n > 0) {
-            // Формируем окончательный список
-            areaTemp->next = newAreaFirst;
-            newAreaFirst = areaTemp;
-
-            // И еще посчитаем центральную точку
-            areaTemp->pt.x = areaTemp->pt1.x + (areaTemp->pt2.x - areaTemp->pt1.x)/2;
-            areaTemp->pt.y = areaTemp->pt1.y + (areaTemp->pt2.y - areaTemp->pt1.y)/2;
-
-            // Дополнительно создаем STL список
-            Area area;
-            area.ptReal[0] = areaTemp->pt.x;
-            area.ptReal[1] = areaTemp->pt.y;
-            area.widthReal  = areaTemp->pt2.x - areaTemp->pt1.x;
-            area.heightReal = areaTemp->pt2.y - areaTemp->pt1.y;
-            areas.push_back(area);
-        }
-        else {
-            delete areaTemp;
-        }
+// Сумма квадратов 0..k
+static inline qint64 sumSquares(qint64 k)
+{
+    return k * (k + 1) * (2*k + 1) / 6;
+}
+
+void Clustering::addMoments(Region &region, const Run &run)
+{
+    // Суммы x и x*x по отрезку [x1, x2] в замкнутом виде
+    qint64 n = run.x2 - run.x1 + 1;
+    qint64 y = run.y;
+    qint64 sx = (qint64(run.x1) + run.x2) * n / 2;
+    qint64 sxx = sumSquares(run.x2) - sumSquares(run.x1 - 1);
+
+    region.m10 += sx;
+    region.m01 += y * n;
+    region.m20 += sxx;
+    region.m11 += y * sx;
+    region.m02 += y * y * n;
+}
+
+void Clustering::setMoments(Area &area, const Region &region)
+{
+    double n = region.n;
+    double cx = region.m10 / n;
+    double cy = region.m01 / n;
+
+    // Центральные моменты второго порядка, нормированные на n
+    double mu20 = region.m20 / n - cx*cx;
+    double mu11 = region.m11 / n - cx*cy;
+    double mu02 = region.m02 / n - cy*cy;
+
+    // Собственные значения ковариационной матрицы
+    double half = (mu20 + mu02) / 2;
+    double diff = sqrt((mu20 - mu02)*(mu20 - mu02) / 4 + mu11*mu11);
+
+    area.pixels = region.n;
+    area.centroidReal[0] = cx;
+    area.centroidReal[1] = cy;
+    area.orientation = 0.5 * atan2(2*mu11, mu20 - mu02);
+    area.majorAxisReal = 4 * sqrt(half + diff);
+    area.minorAxisReal = 4 * sqrt(qMax(0.0, half - diff));
+}
+
+int Clustering::findRoot(vector<Run> &runs, int i)
+{
+    while ( runs[i].parent != i ) {
+        // Сокращение пути вдвое
+        runs[i].parent = runs[runs[i].parent].parent;
+        i = runs[i].parent;
     }
+    return i;
+}
 
-    firstArea = newAreaFirst;
+void Clustering::unite(vector<Run> &runs, int a, int b)
+{
+    a = findRoot(runs, a);
+    b = findRoot(runs, b);
+
+    // Корнем остается более ранний отрезок
+    if ( a < b )
+        runs[b].parent = a;
+    else if ( b < a )
+        runs[a].parent = b;
 }
 
-void Clustering::clearCvAreas()
+void Clustering::buildIntegral(IplImage *hit)
 {
-    CvArea *areaTemp;
-    while (firstArea!=NULL) {
-        areaTemp = firstArea;
-        firstArea = firstArea->next;
-        delete areaTemp;
+    int w = hit->width + 1;
+    integralWidth = hit->width;
+    integral.resize(w * (hit->height + 1));
+
+    for( int x=0; x<w; x++ )
+        integral[x] = 0;
+
+    for( int y=0; y<hit->height; y++ ) {
+
+        uchar* hit_ptr = (uchar*) (hit->imageData + y * hit->widthStep);
+        int *prev = &integral[y*w];
+        int *cur = &integral[(y+1)*w];
+
+        int rowSum = 0;
+        cur[0] = 0;
+        for( int x=0; x<hit->width; x++ ) {
+            rowSum += hit_ptr[x] != 0;
+            cur[x+1] = prev[x+1] + rowSum;
+        }
+    }
+}
+
+void Clustering::buildIntegral(HitMask &hit)
+{
+    int w = hit.getWidth() + 1;
+    integralWidth = hit.getWidth();
+    integral.resize(w * (hit.getHeight() + 1));
+
+    for( int x=0; x<w; x++ )
+        integral[x] = 0;
+
+    for( int y=0; y<hit.getHeight(); y++ ) {
+
+        const quint64 *hit_ptr = hit.row(y);
+        int *prev = &integral[y*w];
+        int *cur = &integral[(y+1)*w];
+
+        int rowSum = 0;
+        cur[0] = 0;
+        for( int x=0; x<hit.getWidth(); x+=64 ) {
+            quint64 word = hit_ptr[x >> 6];
+            int count = hit.getWidth() - x < 64 ? hit.getWidth() - x : 64;
+
+            // Пустые слова - самый частый случай
+            if ( !word ) {
+                for( int i=0; i<count; i++ )
+                    cur[x+i+1] = prev[x+i+1] + rowSum;
+                continue;
+            }
+
+            for( int i=0; i<count; i++ ) {
+                rowSum += (word >> i) & 1;
+                cur[x+i+1] = prev[x+i+1] + rowSum;
+            }
+        }
     }
 }
 
 void Clustering::tableClustering(IplImage *hit, Areas &areas)
+{
+    // Плотность каждой ячейки берется из таблицы сумм за O(1),
+    // поэтому ячейки можно делать размером в 1-2 пикселя
+    buildIntegral(hit);
+    findCells(hit->width, hit->height, areas);
+}
+
+void Clustering::tableClustering(HitMask &hit, Areas &areas)
+{
+    buildIntegral(hit);
+    findCells(hit.getWidth(), hit.getHeight(), areas);
+}
+
+void Clustering::findCells(int width, int height, Areas &areas)
 {
     areas.clear();
     int cellX = tableClusterParam.cellWidth;
     int cellY = tableClusterParam.cellHeight;
     int density = tableClusterParam.density;
 
-    for (int i=0; i<hit->width/cellX; i++)
-        for (int j=0; j<hit->height/cellY; j++)
+    // Столбцы снаружи, как и раньше: от порядка Areas зависит
+    // сопоставление в findSeqAreas и номера последовательностей
+    for (int i=0; i<width/cellX; i++)
+        for (int j=0; j<height/cellY; j++)
         {
-            int n = 0;
-            for( int y=j*cellY; y<j*cellY+cellY; y++ ) {
-                uchar* hit_ptr = (uchar*) (hit->imageData + y * hit->widthStep);
-                for( int x=i*cellX; x<i*cellX+cellX; x++ ) {
-                    if ( hit_ptr[x] )
-                    {
-                        n++;
-                    }
-                }
-            }
+            int n = hitCount(i*cellX, j*cellY, cellX, cellY);
+
             if ( n > 0 && (float)n/(float)(cellX*cellY)*100.0 >= density ) {
                 Area area;
                 area.ptReal[0] = i*cellX + cellX/2;
                 area.ptReal[1] = j*cellY + cellY/2;
                 area.widthReal  = cellX;
                 area.heightReal = cellY;
+                area.pixels = n;
+                area.centroidReal[0] = area.ptReal[0];
+                area.centroidReal[1] = area.ptReal[1];
+                area.orientation = cellY > cellX ? M_PI/2 : 0;
+                area.majorAxisReal = qMax(cellX, cellY);
+                area.minorAxisReal = qMin(cellX, cellY);
                 areas.push_back(area);
             }
 
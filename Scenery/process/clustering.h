@@ -3,6 +3,8 @@
 
 #include <opencv/cxcore.h>
 #include "processdata.h"
+#include "hitmask.h"
+#include "threadpool.h"
 
 class Clustering
 {
@@ -11,6 +13,11 @@ public:
     ~Clustering();
 
     void findClusters(IplImage *hit, Areas &areas);
+    void findClusters(HitMask &hit, Areas &areas);
+
+    // Потоки, между которыми делятся полосы строк в ClusterSimple.
+    // Без них разметка идет в вызывающем потоке
+    void setThreadPool(ThreadPool *pool) { threadPool = pool; }
 
     enum ClusterMode {
         ClusterNone,
@@ -19,15 +26,19 @@ public:
     };
 
     void setClusterMode(ClusterMode mode) { clusterMode = mode; }
+    ClusterMode getClusterMode() { return clusterMode; }
 
     struct SimpleClusterParam {
         int distance; // Расстояние между соседними точками и регионами,
                       // чтобы образовать один регион
         int limit;    // Минимальное кол-во пикселей в регионе
         int density;  // Минимальная плотность точек в регионе
+        int tileRows; // Высота полосы строк, которую размечает один поток
+                      // (0 - одна полоса на поток)
     };
 
     void setSimpleClusterParam(SimpleClusterParam param);
+    SimpleClusterParam getSimpleClusterParam() { return simpleClusterParam; }
 
     struct TableClusterParam {
         int cellWidth;   // Ширина и высота ячеек, на которые разобъется изображение
@@ -36,6 +47,21 @@ public:
     };
 
     void setTableClusterParam(TableClusterParam param);
+    TableClusterParam getTableClusterParam() { return tableClusterParam; }
+
+    // Таблица сумм (интегральное изображение) отмеченных точек.
+    // Строится в режиме ClusterTable на каждом кадре, другие этапы
+    // могут построить ее сами через buildIntegral
+    void buildIntegral(IplImage *hit);
+    void buildIntegral(HitMask &hit);
+
+    // Количество отмеченных точек в прямоугольнике
+    // [x, x+width) x [y, y+height), считается за O(1)
+    int hitCount(int x, int y, int width, int height) {
+        int w = integralWidth + 1;
+        return integral[(y+height)*w + x+width] - integral[y*w + x+width]
+             - integral[(y+height)*w + x]       + integral[y*w + x];
+    }
 
 private:
     // ===============================================================
@@ -44,38 +70,107 @@ private:
 
     SimpleClusterParam simpleClusterParam;
 
-    // Регион, который соответствует определенному параметру
-    struct CvArea {
-        CvPoint pt;
+    // Непрерывный отрезок отмеченных пикселей в одной строке
+    struct Run {
+        int y;
+        int x1;         // Первый и последний пиксели отрезка
+        int x2;
+        int parent;     // Родитель в лесе непересекающихся множеств
+    };
 
+    // Регион, собранный из связанных отрезков
+    struct Region {
         CvPoint pt1;
         CvPoint pt2;
-
         int n;          // Количество точек в этом регионе
-        int p;          // Плотность точек в процентах
 
-        CvArea *next;
+        // Сырые моменты точек: суммы x, y, x*x, x*y, y*y.
+        // Считаются по отрезкам целиком, без обхода пикселей
+        qint64 m10;
+        qint64 m01;
+        qint64 m20;
+        qint64 m11;
+        qint64 m02;
     };
 
-    CvArea *firstArea;
+    // Отрезки полосы строк [y0, y1), размеченные независимо
+    // от других полос. Номера отрезков и родителей - внутри полосы
+    struct Tile {
+        int y0;
+        int y1;
+        vector<Run> runs;
+        vector<int> rowRuns;    // Индекс первого отрезка строки y0+i
+    };
 
-    void simpleClustering(IplImage *hit, Areas &areas);
+    // Буферы переиспользуются между кадрами, поэтому
+    // на каждый регион память не выделяется
+    vector<Run> runs;
+    vector<int> rowRuns;        // Индекс первого отрезка каждой строки
+    vector<int> runRegion;      // Номер региона для корневого отрезка
+    vector<Region> regions;
 
-    // Обрабатываем точку, как новую часть региона,
-    // заносим сырые данные о регионах в CvArea
-    void findAreas(int x, int y);
+    ThreadPool *threadPool;
+    vector<Tile> tiles;
+    int tileCount;
 
-    // Объединяем регионы CvArea, убираем ненужные
-    // и конвертируем CvArea в Area
-    void filterAreas(Areas &areas);
+    // Маска текущего кадра для findTileRuns
+    IplImage *tileHitImage;
+    HitMask *tileHitMask;
 
-    // Очищаем список структур CvArea
-    void clearCvAreas();
+    void simpleClustering(IplImage *hit, Areas &areas);
+    void simpleClustering(HitMask &hit, Areas &areas);
+
+    // Первый проход: выделяем отрезки в строках и объединяем
+    // отрезки, между которыми не больше simpleClusterParam.distance
+    // пустых пикселей по горизонтали и вертикали.
+    //
+    // Кадр делится на полосы строк, каждая размечается отдельно
+    // (в своем потоке), затем отрезки полос собираются в runs по
+    // порядку и связываются через границы полос. Корень множества -
+    // всегда отрезок с наименьшим номером, поэтому результат не
+    // зависит от количества полос
+    void findRuns(IplImage *hit);
+    void findRuns(HitMask &hit);
+    void findRuns(int height);
+    void findTileRuns(int begin, int end, int thread);
+    void findRuns(IplImage *hit, Tile &tile);
+    void findRuns(HitMask &hit, Tile &tile);
+
+    // Собрать отрезки всех полос в runs и rowRuns
+    // и связать отрезки соседних полос
+    void mergeTiles(int height);
+
+    // Добавить отрезок в строку y полосы и связать его с соседом слева
+    void addRun(Tile &tile, int y, int x1, int x2);
+
+    // Связать все отрезки строки y с отрезками предыдущих строк полосы
+    void linkRuns(Tile &tile, int y);
+
+    // Связать отрезки [a, aEnd) одной строки с отрезками [b, bEnd)
+    // строки выше, если между ними не больше distance пикселей
+    void linkRows(vector<Run> &runs, int a, int aEnd, int b, int bEnd);
+
+    // Второй проход: собираем регионы по корням отрезков,
+    // фильтруем по limit и density и конвертируем в Area
+    void findRegions(Areas &areas);
+    static void addMoments(Region &region, const Run &run);
+    static void setMoments(Area &area, const Region &region);
+
+    static int findRoot(vector<Run> &runs, int i);
+    static void unite(vector<Run> &runs, int a, int b);
 
     // ===============================================================
     TableClusterParam tableClusterParam;
 
+    // (width+1)*(height+1) сумм, первая строка и столбец - нули
+    vector<int> integral;
+    int integralWidth;
+
     void tableClustering(IplImage *hit, Areas &areas);
+    void tableClustering(HitMask &hit, Areas &areas);
+
+    // Ячейки с нужной плотностью по построенной таблице сумм
+    void findCells(int width, int height, Areas &areas);
 
 };
 
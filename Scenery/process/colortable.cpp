@@ -0,0 +1,120 @@
+#include "colortable.h"
+
+#include <QMutexLocker>
+
+ColorTable::ColorTable()
+{
+    generation = 0;
+    dirty = false;
+    stopped = false;
+    running = false;
+    active = 0;
+}
+
+ColorTable::~ColorTable()
+{
+    mutex.lock();
+    stopped = true;
+    dirty = true;
+    mutex.unlock();
+
+    wait();
+
+    delete ready.fetchAndStoreOrdered(0);
+    delete active;
+}
+
+void ColorTable::build(const ProcessSimd::ColorRange &range, int generation)
+{
+    QMutexLocker locker(&mutex);
+
+    this->range = range;
+    this->generation = generation;
+    dirty = true;
+
+    if (!running) {
+        // Поток мог только что выйти из цикла, дожидаемся его завершения
+        wait();
+        running = true;
+        start(QThread::LowPriority);
+    }
+}
+
+const ColorTable::Table *ColorTable::take()
+{
+    Table *table = ready.fetchAndStoreOrdered(0);
+    if (table) {
+        delete active;
+        active = table;
+    }
+    return active;
+}
+
+void ColorTable::run()
+{
+    Table *table = 0;
+
+    forever {
+        mutex.lock();
+        if (!dirty || stopped) {
+            running = false;
+            mutex.unlock();
+            break;
+        }
+        ProcessSimd::ColorRange range = this->range;
+        int generation = this->generation;
+        dirty = false;
+        mutex.unlock();
+
+        if (!table)
+            table = new Table;
+
+        if (!fill(table, range))
+            continue;
+
+        table->generation = generation;
+
+        // Если предыдущую таблицу еще не забрали, используем ее память
+        // для следующего построения
+        table = ready.fetchAndStoreOrdered(table);
+    }
+
+    delete table;
+}
+
+bool ColorTable::fill(Table *table, const ProcessSimd::ColorRange &range)
+{
+    unsigned char bgr[3*256];
+    unsigned char hit[256];
+
+    for (int b=0; b<256; b++)
+        bgr[3*b+0] = b;
+
+    unsigned int *bits = table->bits;
+
+    for (int r=0; r<256; r++) {
+        if (dirty)
+            return false;
+
+        for (int g=0; g<256; g++) {
+            for (int b=0; b<256; b++) {
+                bgr[3*b+1] = g;
+                bgr[3*b+2] = r;
+            }
+
+            ProcessSimd::findColor(bgr, hit, 256, range);
+
+            // 256 значений b - это 8 слов по 32 бита
+            for (int w=0; w<8; w++) {
+                unsigned int word = 0;
+                for (int i=0; i<32; i++) {
+                    if (hit[w*32 + i])
+                        word |= 1u << i;
+                }
+                *bits++ = word;
+            }
+        }
+    }
+
+    return true;
+}
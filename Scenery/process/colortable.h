@@ -0,0 +1,56 @@
+#ifndef COLORTABLE_H
+#define COLORTABLE_H
+
+#include <QThread>
+#include <QMutex>
+#include <QAtomicPointer>
+
+#include "processsimd.h"
+
+// Скомпилированное условие Process::findColor: один бит на каждый
+// цвет RGB (2^24 бит = 2 Мб). Таблица перестраивается в отдельном
+// потоке, поэтому изменение параметров не задерживает обработку кадров.
+class ColorTable : public QThread
+{
+public:
+    ColorTable();
+    ~ColorTable();
+
+    struct Table {
+        unsigned int bits[256*256*256/32];
+        int generation;     // Номер параметров, по которым построена таблица
+
+        bool test(unsigned char r, unsigned char g, unsigned char b) const {
+            int ss = r*256*256 + g*256 + b;
+            return (bits[ss >> 5] >> (ss & 31)) & 1;
+        }
+    };
+
+    // Запросить построение таблицы для нового диапазона.
+    // Если таблица уже строится, построение начнется заново
+    void build(const ProcessSimd::ColorRange &range, int generation);
+
+    // Вызывается потоком обработки в начале кадра: подменяет текущую
+    // таблицу на последнюю построенную. Возвращает 0, пока ни одна
+    // таблица не готова
+    const Table *take();
+
+protected:
+    void run();
+
+private:
+    QMutex mutex;
+    ProcessSimd::ColorRange range;
+    int generation;
+    volatile bool dirty;    // Есть новый запрос
+    bool stopped;
+    bool running;
+
+    QAtomicPointer<Table> ready;    // Построенная, но еще не забранная таблица
+    Table *active;                  // Таблица, которой пользуется поток обработки
+
+    // Возвращает false, если построение прервано новым запросом
+    bool fill(Table *table, const ProcessSimd::ColorRange &range);
+};
+
+#endif // COLORTABLE_H
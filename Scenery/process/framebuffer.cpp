@@ -0,0 +1,90 @@
+#include "framebuffer.h"
+
+QAtomicInt FramePool::allocations(0);
+QAtomicInt FramePool::copies(0);
+
+Frame::Frame(const Frame &other)
+{
+    buffer = other.buffer;
+    if (buffer)
+        buffer->refs.fetchAndAddOrdered(1);
+}
+
+Frame::~Frame()
+{
+    release();
+}
+
+Frame &Frame::operator=(const Frame &other)
+{
+    if ( other.buffer )
+        other.buffer->refs.fetchAndAddOrdered(1);
+
+    release();
+    buffer = other.buffer;
+    return *this;
+}
+
+void Frame::release()
+{
+    if (buffer)
+        buffer->refs.fetchAndAddOrdered(-1);
+    buffer = 0;
+}
+
+FramePool::FramePool(int width, int height, int size)
+{
+    this->width = width;
+    this->height = height;
+
+    for ( int i=0; i<size; i++ ) {
+        buffers.append(create());
+    }
+}
+
+FramePool::~FramePool()
+{
+    for ( int i=0; i<buffers.size(); i++ ) {
+        buffers[i]->image->imageData = buffers[i]->data;
+        cvReleaseImage(&buffers[i]->image);
+        delete buffers[i];
+    }
+}
+
+FrameBuffer *FramePool::create()
+{
+    FrameBuffer *buffer = new FrameBuffer;
+    buffer->image = cvCreateImage( cvSize(width, height), IPL_DEPTH_8U, 3 );
+    buffer->data = buffer->image->imageData;
+    buffer->number = 0;
+    buffer->time = 0;
+
+    allocations.fetchAndAddOrdered(1);
+    return buffer;
+}
+
+FrameBuffer *FramePool::take()
+{
+    for ( int i=0; i<buffers.size(); i++ ) {
+        if ( buffers[i]->refs.testAndSetOrdered(0, -1) )
+            return buffers[i];
+    }
+
+    // Все буферы заняты, пул растет
+    FrameBuffer *buffer = create();
+    buffer->refs.fetchAndStoreOrdered(-1);
+    buffers.append(buffer);
+    return buffer;
+}
+
+void FramePool::resetCounters()
+{
+    allocations.fetchAndStoreOrdered(0);
+    copies.fetchAndStoreOrdered(0);
+}
+
+void FramePool::copy(IplImage *source, IplImage *dest)
+{
+    cvCopy(source, dest);
+    copies.fetchAndAddOrdered(1);
+}
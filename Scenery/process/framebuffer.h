@@ -0,0 +1,95 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <QAtomicInt>
+#include <QVector>
+
+#include <opencv/cxcore.h>
+
+class FramePool;
+class FrameRing;
+
+// Буфер кадра из пула. Счетчик ссылок: -1 - идет запись,
+// 0 - буфер свободен, больше 0 - кадр кто-то держит
+class FrameBuffer
+{
+private:
+    FrameBuffer() : refs(0), taken(0) {}
+
+    IplImage *image;
+    char *data;         // Собственные данные image. image->imageData может
+                        // указывать на внешние данные (FrameRing::beginWrite)
+    unsigned int number;
+    qint64 time;
+
+    QAtomicInt refs;
+    QAtomicInt taken;   // Кадр хотя бы раз взяли из кольца
+
+    friend class Frame;
+    friend class FramePool;
+    friend class FrameRing;
+};
+
+// Ссылка на кадр в пуле. Копирование ссылки только увеличивает счетчик,
+// буфер возвращается в пул, когда исчезает последняя ссылка.
+// Изображение кадра после записи не меняется, поэтому его можно
+// читать из разных потоков без блокировок
+class Frame
+{
+public:
+    Frame() : buffer(0) {}
+    Frame(const Frame &other);
+    ~Frame();
+
+    Frame &operator=(const Frame &other);
+
+    bool isNull() const { return buffer == 0; }
+    void release();
+
+    IplImage *getImage() const { return buffer ? buffer->image : 0; }
+    unsigned int getNumber() const { return buffer ? buffer->number : 0; }
+    qint64 getTime() const { return buffer ? buffer->time : 0; }
+
+private:
+    // Забирает уже увеличенную ссылку на buffer
+    explicit Frame(FrameBuffer *buffer) : buffer(buffer) {}
+
+    FrameBuffer *buffer;
+
+    friend class FrameRing;
+};
+
+// Пул буферов кадров одного размера. Новые буферы создаются, только
+// когда все старые заняты, поэтому после первых кадров выделений
+// памяти больше нет. Брать буферы должен один поток
+class FramePool
+{
+public:
+    FramePool(int width, int height, int size);
+    ~FramePool();
+
+    // Свободный буфер для записи, счетчик ссылок -1
+    FrameBuffer *take();
+
+    // Счетчики для всех пулов: сколько создано буферов и сколько раз
+    // кадры копировались через copy(). Позволяют проверить, что
+    // обработка не выделяет память и не копирует кадры на каждом кадре
+    static int getAllocations() { return allocations.fetchAndAddOrdered(0); }
+    static int getCopies() { return copies.fetchAndAddOrdered(0); }
+    static void resetCounters();
+
+    // Копирование кадра, учитывается в getCopies()
+    static void copy(IplImage *source, IplImage *dest);
+
+private:
+    int width;
+    int height;
+    QVector<FrameBuffer *> buffers;
+
+    FrameBuffer *create();
+
+    static QAtomicInt allocations;
+    static QAtomicInt copies;
+};
+
+#endif // FRAMEBUFFER_H
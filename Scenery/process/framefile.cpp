@@ -0,0 +1,163 @@
+#include "framefile.h"
+
+#include <QDebug>
+
+#include <string.h>
+
+// Начало каждого кадра выравнивается на 16 байт
+static unsigned int align16(unsigned int size)
+{
+    return (size + 15) & ~15u;
+}
+
+// ========================================================================
+// FrameWriter
+// ========================================================================
+
+FrameWriter::FrameWriter()
+{
+    memset(&header, 0, sizeof(header));
+}
+
+FrameWriter::~FrameWriter()
+{
+    close();
+}
+
+bool FrameWriter::open(QString file, int width, int height, int widthStep)
+{
+    close();
+
+    this->file.setFileName(file);
+    if ( !this->file.open(QIODevice::WriteOnly | QIODevice::Truncate) ) {
+        qDebug() << "Error open record file:" << file;
+        return false;
+    }
+
+    header.magic = FRAME_FILE_MAGIC;
+    header.version = FRAME_FILE_VERSION;
+    header.headerSize = align16(sizeof(FrameFileHeader));
+    header.width = width;
+    header.height = height;
+    header.widthStep = widthStep;
+    header.imageSize = widthStep * height;
+    header.frameSize = align16(sizeof(FrameFileRecord) + header.imageSize);
+
+    QByteArray block(header.headerSize, '\0');
+    memcpy(block.data(), &header, sizeof(header));
+    this->file.write(block);
+
+    qDebug() << "Record file:" << file << width << height;
+    return true;
+}
+
+void FrameWriter::close()
+{
+    if ( file.isOpen() )
+        file.close();
+}
+
+bool FrameWriter::write(const IplImage *image, unsigned int number, qint64 time)
+{
+    if ( !file.isOpen() )
+        return false;
+
+    Q_ASSERT(image->width == header.width && image->height == header.height);
+    Q_ASSERT(image->widthStep == header.widthStep);
+
+    FrameFileRecord record;
+    record.time = time;
+    record.number = number;
+    record.reserved = 0;
+
+    static const char padding[16] = {0};
+    unsigned int size = sizeof(record) + header.imageSize;
+
+    bool ok = file.write((const char *)&record, sizeof(record)) == sizeof(record)
+           && file.write(image->imageData, header.imageSize) == header.imageSize
+           && file.write(padding, header.frameSize - size) == header.frameSize - size;
+
+    if (!ok) {
+        qDebug() << "Error write record file:" << file.fileName();
+        file.close();
+    }
+    return ok;
+}
+
+// ========================================================================
+// FrameReader
+// ========================================================================
+
+FrameReader::FrameReader()
+{
+    data = 0;
+    count = 0;
+    memset(&header, 0, sizeof(header));
+}
+
+FrameReader::~FrameReader()
+{
+    close();
+}
+
+bool FrameReader::open(QString file)
+{
+    close();
+
+    this->file.setFileName(file);
+    if ( !this->file.open(QIODevice::ReadOnly) ) {
+        qDebug() << "Error open replay file:" << file;
+        return false;
+    }
+
+    qint64 size = this->file.size();
+    if ( size < (qint64)sizeof(FrameFileHeader) ) {
+        qDebug() << "Error replay file header:" << file;
+        this->file.close();
+        return false;
+    }
+
+    this->file.read((char *)&header, sizeof(header));
+    if ( header.magic != FRAME_FILE_MAGIC || header.version != FRAME_FILE_VERSION ||
+         header.frameSize < sizeof(FrameFileRecord) + header.imageSize ) {
+        qDebug() << "Error replay file format:" << file;
+        this->file.close();
+        return false;
+    }
+
+    // Неполный последний кадр (запись прервана) не учитывается
+    count = (size - header.headerSize) / header.frameSize;
+
+    data = this->file.map(0, size);
+    if (!data) {
+        qDebug() << "Error map replay file:" << file;
+        this->file.close();
+        count = 0;
+        return false;
+    }
+
+    qDebug() << "Replay file:" << file << header.width << header.height << count;
+    return true;
+}
+
+void FrameReader::close()
+{
+    if (data) {
+        file.unmap(data);
+        data = 0;
+    }
+    if ( file.isOpen() )
+        file.close();
+    count = 0;
+}
+
+const FrameFileRecord *FrameReader::getRecord(int n)
+{
+    Q_ASSERT(data && n >= 0 && n < count);
+    return (const FrameFileRecord *)(data + header.headerSize + (qint64)n * header.frameSize);
+}
+
+char *FrameReader::getImageData(int n)
+{
+    return (char *)getRecord(n) + sizeof(FrameFileRecord);
+}
@@ -0,0 +1,84 @@
+#ifndef FRAMEFILE_H
+#define FRAMEFILE_H
+
+#include <QFile>
+#include <QString>
+
+#include <opencv/cxcore.h>
+
+// Файл записанных кадров: несжатые кадры BGR с временем захвата.
+// Кадры лежат с фиксированным шагом и выравниванием 16 байт, поэтому
+// файл можно отобразить в память и отдавать кадры без копирования.
+//
+//   FrameFileHeader                 (headerSize байт)
+//   FrameFileRecord + изображение   (frameSize байт на кадр)
+//
+// Изображение - imageSize байт, строки по widthStep байт, как в IplImage
+
+#define FRAME_FILE_MAGIC   0x52464353   // "SCFR"
+#define FRAME_FILE_VERSION 1
+
+struct FrameFileHeader {
+    unsigned int magic;
+    unsigned int version;
+    unsigned int headerSize;
+    unsigned int frameSize;     // Запись кадра вместе с изображением
+    int width;
+    int height;
+    int widthStep;
+    int imageSize;
+};
+
+struct FrameFileRecord {
+    qint64 time;                // Время захвата, мкс (Clock записавшей программы)
+    unsigned int number;
+    unsigned int reserved;
+};
+
+// Запись кадров в файл
+class FrameWriter
+{
+public:
+    FrameWriter();
+    ~FrameWriter();
+
+    bool open(QString file, int width, int height, int widthStep);
+    void close();
+    bool isOpen() { return file.isOpen(); }
+
+    bool write(const IplImage *image, unsigned int number, qint64 time);
+
+private:
+    QFile file;
+    FrameFileHeader header;
+};
+
+// Чтение файла кадров через отображение в память
+class FrameReader
+{
+public:
+    FrameReader();
+    ~FrameReader();
+
+    bool open(QString file);
+    void close();
+    bool isOpen() { return data != 0; }
+
+    int getCount() { return count; }
+    int getWidth() { return header.width; }
+    int getHeight() { return header.height; }
+    int getWidthStep() { return header.widthStep; }
+
+    // Запись и изображение кадра n. Память принадлежит отображению
+    // и действительна до close()
+    const FrameFileRecord *getRecord(int n);
+    char *getImageData(int n);
+
+private:
+    QFile file;
+    uchar *data;
+    FrameFileHeader header;
+    int count;
+};
+
+#endif // FRAMEFILE_H
@@ -0,0 +1,119 @@
+#include "framering.h"
+
+#include <QMutexLocker>
+
+FrameRing::FrameRing(int width, int height, int pinned) :
+    // Последний кадр, кадр в записи и кадры, закрепленные обработкой
+    pool(width, height, pinned + 2),
+    latest(0),
+    latestNumber(0),
+    dropped(0)
+{
+    writing = 0;
+}
+
+FrameRing::~FrameRing()
+{
+    FrameBuffer *last = latest.fetchAndStoreOrdered(0);
+    if (last)
+        last->refs.fetchAndAddOrdered(-1);
+}
+
+IplImage *FrameRing::beginWrite(char *data)
+{
+    Q_ASSERT(!writing);
+
+    // Последний кадр не освободится, пока кольцо держит на него ссылку
+    writing = pool.take();
+    writing->image->imageData = data ? data : writing->data;
+    return writing->image;
+}
+
+void FrameRing::endWrite(unsigned int number, qint64 time)
+{
+    Q_ASSERT(writing);
+
+    writing->number = number;
+    writing->time = time;
+    writing->taken.fetchAndStoreOrdered(0);
+    writing->refs.fetchAndStoreOrdered(1);
+
+    FrameBuffer *prev = latest.fetchAndStoreOrdered(writing);
+    latestNumber.fetchAndStoreOrdered(number);
+    writing = 0;
+
+    if (prev) {
+        if ( !prev->taken.fetchAndAddOrdered(0) )
+            dropped.fetchAndAddOrdered(1);
+        prev->refs.fetchAndAddOrdered(-1);
+    }
+
+    QMutexLocker locker(&mutex);
+    written.wakeAll();
+}
+
+bool FrameRing::acquire(Frame &frame, unsigned int after)
+{
+    frame.release();
+
+    for (;;) {
+        FrameBuffer *buffer = latest.fetchAndAddOrdered(0);
+        if ( !buffer )
+            return false;
+
+        // 0 - пока читали указатель, кольцо отпустило буфер,
+        // -1 - захват уже пишет в него новый кадр.
+        // В обоих случаях последним объявлен другой буфер
+        int refs = buffer->refs.fetchAndAddOrdered(0);
+        if ( refs <= 0 )
+            continue;
+
+        if ( !buffer->refs.testAndSetOrdered(refs, refs + 1) )
+            continue;
+
+        // Пока закрепляли, вышел кадр новее - берем его
+        if ( latest.fetchAndAddOrdered(0) != buffer ) {
+            buffer->refs.fetchAndAddOrdered(-1);
+            continue;
+        }
+
+        // Буфер закреплен, захват в него больше не пишет
+        if ( buffer->number <= after ) {
+            buffer->refs.fetchAndAddOrdered(-1);
+            return false;
+        }
+
+        buffer->taken.fetchAndStoreOrdered(1);
+        frame = Frame(buffer);
+        return true;
+    }
+}
+
+bool FrameRing::wait(unsigned int after, unsigned long timeout)
+{
+    QMutexLocker locker(&mutex);
+
+    if ( getLatest() <= after )
+        written.wait(&mutex, timeout);
+
+    return getLatest() > after;
+}
+
+void FrameRing::wakeAll()
+{
+    QMutexLocker locker(&mutex);
+    written.wakeAll();
+}
+
+unsigned int FrameRing::getLatest()
+{
+    return latestNumber.fetchAndAddOrdered(0);
+}
+
+bool FrameRing::isLatestTaken()
+{
+    // Последний кадр меняет только поток захвата, и кольцо держит
+    // на него ссылку, поэтому буфер не может освободиться
+    FrameBuffer *buffer = latest.fetchAndAddOrdered(0);
+    return !buffer || buffer->taken.fetchAndAddOrdered(0);
+}
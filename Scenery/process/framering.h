@@ -0,0 +1,68 @@
+#ifndef FRAMERING_H
+#define FRAMERING_H
+
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include "framebuffer.h"
+
+// Кольцо кадров между одним потоком захвата и несколькими потоками
+// обработки. Захват пишет в свободный буфер пула и объявляет его
+// последним кадром, обработка закрепляет последний кадр ссылкой Frame
+// и работает с ним без копирования. Кто не успевает, получает сразу
+// самый новый кадр, пропущенные кадры только подсчитываются.
+//
+// Запись и закрепление кадров не берут блокировок; мьютекс нужен
+// только для того, чтобы потоки обработки могли спать в wait().
+class FrameRing
+{
+public:
+    // pinned - сколько кадров обычно держат все потоки обработки.
+    // Если держат больше, пул буферов растет
+    FrameRing(int width, int height, int pinned = 2);
+    ~FrameRing();
+
+    // Захват: получить свободный буфер и объявить его последним кадром.
+    // data - готовое изображение с тем же widthStep (например, кадр
+    // отображенного в память файла): кадр ссылается на него без
+    // копирования, и оно должно жить, пока живы ссылки на кадр
+    IplImage *beginWrite(char *data = 0);
+    void endWrite(unsigned int number, qint64 time);
+
+    // Обработка: закрепить последний кадр, если его номер больше after.
+    // Кадр освобождается вместе с последней ссылкой на него
+    bool acquire(Frame &frame, unsigned int after = 0);
+
+    // Дождаться кадра с номером больше after (не дольше timeout мс)
+    bool wait(unsigned int after, unsigned long timeout);
+
+    // Разбудить все ожидающие потоки, например перед остановкой
+    void wakeAll();
+
+    // Номер последнего записанного кадра
+    unsigned int getLatest();
+
+    // Последний кадр уже взял хотя бы один поток обработки.
+    // Вызывать из потока захвата
+    bool isLatestTaken();
+
+    // Сколько кадров заменено более новыми, пока их никто не взял
+    int getDropped() { return dropped.fetchAndAddOrdered(0); }
+
+private:
+    FramePool pool;
+
+    // Последний кадр, кольцо держит на него одну ссылку
+    QAtomicPointer<FrameBuffer> latest;
+    QAtomicInt latestNumber;
+    FrameBuffer *writing;   // Буфер, в который пишет захват
+
+    QAtomicInt dropped;
+
+    QMutex mutex;
+    QWaitCondition written;
+};
+
+#endif // FRAMERING_H
@@ -0,0 +1,69 @@
+#include "framestats.h"
+
+#include <QMutexLocker>
+
+#include <math.h>
+
+// Пока интервалов мало, средний интервал ненадежен и пропуски не считаются
+#define FRAME_STATS_MIN_SAMPLES 10
+
+FrameStats::FrameStats()
+{
+    intervals.resize(FRAME_STATS_SAMPLES);
+    next = 0;
+    count = 0;
+    sum = 0;
+    last = 0;
+    gaps = 0;
+}
+
+void FrameStats::add(qint64 time)
+{
+    QMutexLocker locker(&mutex);
+
+    if (!last) {
+        last = time;
+        return;
+    }
+
+    qint64 interval = time - last;
+    last = time;
+
+    if ( count >= FRAME_STATS_MIN_SAMPLES ) {
+        double mean = (double)sum / count;
+        if ( interval > 1.5 * mean )
+            gaps += (int)(interval / mean + 0.5) - 1;
+    }
+
+    if ( count == FRAME_STATS_SAMPLES )
+        sum -= intervals[next];
+    else
+        count++;
+
+    intervals[next] = interval;
+    sum += interval;
+    next = (next + 1) % FRAME_STATS_SAMPLES;
+}
+
+FrameStats::Stats FrameStats::getStats()
+{
+    QMutexLocker locker(&mutex);
+
+    Stats stats;
+    stats.count = count;
+    stats.gaps = gaps;
+    stats.mean = count ? (double)sum / count : 0;
+    stats.fps = stats.mean > 0 ? 1000000.0 / stats.mean : 0;
+    stats.max = 0;
+
+    double variance = 0;
+    for ( int i=0; i<count; i++ ) {
+        double d = intervals[i] - stats.mean;
+        variance += d * d;
+        if ( intervals[i] > stats.max )
+            stats.max = intervals[i];
+    }
+    stats.jitter = count ? sqrt(variance / count) : 0;
+
+    return stats;
+}
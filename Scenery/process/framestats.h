@@ -0,0 +1,43 @@
+#ifndef FRAMESTATS_H
+#define FRAMESTATS_H
+
+#include <QMutex>
+#include <QVector>
+
+// Сколько последних интервалов между кадрами учитывается
+#define FRAME_STATS_SAMPLES 120
+
+// Статистика потока кадров по их меткам времени захвата (Clock):
+// частота, средний интервал, дрожание и пропуски. Пропуском считается
+// интервал больше полутора средних, в нем теряется
+// round(interval / mean) - 1 кадров
+class FrameStats
+{
+public:
+    FrameStats();
+
+    // Метка времени очередного кадра, мкс. Вызывается потоком захвата
+    void add(qint64 time);
+
+    struct Stats {
+        int count;          // Интервалов в окне
+        double fps;         // 1 / средний интервал
+        double mean;        // Средний интервал, мкс
+        double jitter;      // Среднеквадратичное отклонение интервала, мкс
+        qint64 max;         // Наибольший интервал, мкс
+        int gaps;           // Потеряно кадров с запуска
+    };
+
+    Stats getStats();
+
+private:
+    QMutex mutex;
+    QVector<qint64> intervals;
+    int next;
+    int count;
+    qint64 sum;             // Сумма интервалов в окне
+    qint64 last;            // Метка предыдущего кадра (0 - кадров не было)
+    int gaps;
+};
+
+#endif // FRAMESTATS_H
@@ -1,4 +1,5 @@
 #include "debugwindow.h"
+#include <math.h>
 
 DebugWindow::DebugWindow(QString name, int width, int height)
 {
@@ -7,6 +8,7 @@ DebugWindow::DebugWindow(QString name, int width, int height)
     this->height = height;
 
     debug = cvCreateImage( cvSize(width, height), IPL_DEPTH_8U, 3 );
+    hit = cvCreateImage( cvSize(width, height), IPL_DEPTH_8U, 1 );
 
     cvNamedWindow(name.toStdString().c_str(), CV_WINDOW_FREERATIO);
     //cvNamedWindow("Hit", CV_WINDOW_FREERATIO);
@@ -14,41 +16,54 @@ DebugWindow::DebugWindow(QString name, int width, int height)
 
 DebugWindow::~DebugWindow()
 {
+    cvReleaseImage(&debug);
+    cvReleaseImage(&hit);
     cvDestroyAllWindows();
 }
 
-void DebugWindow::show(IplImage *image, Process *process)
+void DebugWindow::show(const ProcessResult *result, Process *process)
 {
-    if (!image)
+    if (result->frame.isNull())
         return;
 
-    cvCopy(image, debug);
+    // Рисовать прямо на кадре нельзя, его читают другие потоки
+    FramePool::copy(result->frame.getImage(), debug);
 
-    switch (process->getMode()) {
+    // Упакованная маска разворачивается только для режимов,
+    // которые ее показывают
+    Process::Mode mode = process->getMode();
+    if ( mode == Process::ProcessColor || mode == Process::ProcessMotion ||
+         mode == Process::ProcessContour )
+        result->hitMask.toImage(hit);
+
+    const Areas &areas = result->areas;
+    const SeqAreas &seqAreas = result->seqAreas;
+
+    switch (mode) {
     case Process::ProcessNone:
         break;
     case Process::ProcessColor:
-        cvSet(debug, CV_RGB(255,255,255), process->getHitImage());
-        drawAreasReal(debug, process->getAreas(), CV_RGB(255,255,0));
-        drawAreas(debug, process->getAreas(), CV_RGB(150,0,0));
-        drawSeqAreas(debug, process->getSeqAreas(), CV_RGB(255,0,0));
+        cvSet(debug, CV_RGB(255,255,255), hit);
+        drawAreasReal(debug, areas, CV_RGB(255,255,0));
+        drawAreas(debug, areas, CV_RGB(150,0,0));
+        drawSeqAreas(debug, seqAreas, CV_RGB(255,0,0));
         break;
     case Process::ProcessMotion:
-        cvSet(debug, CV_RGB(255,255,255), process->getHitImage());
-        drawAreasReal(debug, process->getAreas(), CV_RGB(255,255,0));
-        drawAreas(debug, process->getAreas(), CV_RGB(150,0,0));
-        drawSeqAreas(debug, process->getSeqAreas(), CV_RGB(255,0,0));
+        cvSet(debug, CV_RGB(255,255,255), hit);
+        drawAreasReal(debug, areas, CV_RGB(255,255,0));
+        drawAreas(debug, areas, CV_RGB(150,0,0));
+        drawSeqAreas(debug, seqAreas, CV_RGB(255,0,0));
         break;
     case Process::ProcessHaar:
-        drawAreasReal(debug, process->getAreas(), CV_RGB(255,255,0));
-        drawAreas(debug, process->getAreas(), CV_RGB(255,0,0));
-        drawSeqAreas(debug, process->getSeqAreas(), CV_RGB(255,0,0));
+        drawAreasReal(debug, areas, CV_RGB(255,255,0));
+        drawAreas(debug, areas, CV_RGB(255,0,0));
+        drawSeqAreas(debug, seqAreas, CV_RGB(255,0,0));
         break;
     case Process::ProcessContour:
-        cvSet(debug, CV_RGB(255,255,255), process->getHitImage());
-        drawAreasReal(debug, process->getAreas(), CV_RGB(255,255,0));
-        drawAreas(debug, process->getAreas(), CV_RGB(150,0,0));
-        drawSeqAreas(debug, process->getSeqAreas(), CV_RGB(255,0,0));
+        cvSet(debug, CV_RGB(255,255,255), hit);
+        drawAreasReal(debug, areas, CV_RGB(255,255,0));
+        drawAreas(debug, areas, CV_RGB(150,0,0));
+        drawSeqAreas(debug, seqAreas, CV_RGB(255,0,0));
         //        for(CvSeq* seq = process->getContours(); seq != 0; seq = seq->h_next){
         //            // нарисовать контур
         //            cvDrawContours(image, seq, CV_RGB(0,0,250), CV_RGB(0,0,250), 0, 1, 8);
@@ -57,9 +72,9 @@ void DebugWindow::show(IplImage *image, Process *process)
         //        }
         break;
     case Process::ProcessHoughCircles:
-        drawAreasReal(debug, process->getAreas(), CV_RGB(255,255,0));
-        drawAreas(debug, process->getAreas(), CV_RGB(255,0,0), 1);
-        drawSeqAreas(debug, process->getSeqAreas(), CV_RGB(255,0,0), 1);
+        drawAreasReal(debug, areas, CV_RGB(255,255,0));
+        drawAreas(debug, areas, CV_RGB(255,0,0), 1);
+        drawSeqAreas(debug, seqAreas, CV_RGB(255,0,0), 1);
         break;
 
 
@@ -68,14 +83,14 @@ void DebugWindow::show(IplImage *image, Process *process)
     drawTransform(debug, process, CV_RGB(255,255,0) );
 
     cvShowImage(name.toStdString().c_str(), debug);
-    //cvShowImage("Hit", process->getHitImage());
+    //cvShowImage("Hit", hit);
 }
 
-void DebugWindow::drawAreas(IplImage *image, Areas &areas, CvScalar color, int type)
+void DebugWindow::drawAreas(IplImage *image, const Areas &areas, CvScalar color, int type)
 {
-    vector<Area>::iterator it = areas.begin();
+    vector<Area>::const_iterator it = areas.begin();
     for (; it != areas.end(); ++it) {
-        Area &area = *it;
+        const Area &area = *it;
         if ( type ==0 ) {
             cvRectangle(image,
                         cvPoint(area.pt[0]-area.width/2, area.pt[1]-area.height/2),
@@ -90,11 +105,11 @@ void DebugWindow::drawAreas(IplImage *image, Areas &areas, CvScalar color, int t
     }
 }
 
-void DebugWindow::drawAreasReal(IplImage *image, Areas &areas, CvScalar color, int type)
+void DebugWindow::drawAreasReal(IplImage *image, const Areas &areas, CvScalar color, int type)
 {
-    vector<Area>::iterator it = areas.begin();
+    vector<Area>::const_iterator it = areas.begin();
     for (; it != areas.end(); ++it) {
-        Area &area = *it;
+        const Area &area = *it;
         if ( type ==0 ) {
             cvRectangle(image,
                         cvPoint(area.ptReal[0]-area.widthReal/2,
@@ -102,6 +117,14 @@ void DebugWindow::drawAreasReal(IplImage *image, Areas &areas, CvScalar color, i
                         cvPoint(area.ptReal[0]+area.widthReal/2,
                                 area.ptReal[1]+area.heightReal/2),
                         color, 1 );
+
+            // Главная ось через центр масс
+            double dx = cos(area.orientation) * area.majorAxisReal/2;
+            double dy = sin(area.orientation) * area.majorAxisReal/2;
+            cvLine(image,
+                   cvPoint(area.centroidReal[0]-dx, area.centroidReal[1]-dy),
+                   cvPoint(area.centroidReal[0]+dx, area.centroidReal[1]+dy),
+                   color, 1 );
         }
         else {
             cvCircle(image, cvPoint(area.ptReal[0], area.pt[1]),
@@ -111,11 +134,11 @@ void DebugWindow::drawAreasReal(IplImage *image, Areas &areas, CvScalar color, i
     }
 }
 
-void DebugWindow::drawSeqAreas(IplImage *image, SeqAreas &seqAreas, CvScalar color, int type)
+void DebugWindow::drawSeqAreas(IplImage *image, const SeqAreas &seqAreas, CvScalar color, int type)
 {
-    vector<SeqArea>::iterator it = seqAreas.begin();
+    vector<SeqArea>::const_iterator it = seqAreas.begin();
     for (; it != seqAreas.end(); ++it) {
-        SeqArea &seqArea = *it;
+        const SeqArea &seqArea = *it;
         if ( seqArea.number > 0 ) {
 
             if (type == 0) {
@@ -159,10 +182,13 @@ void DebugWindow::drawTransform(IplImage *image, Process *process, CvScalar colo
 {
     int p[4][2];
 
-    process->transform2D(0,                        0, p[0][0], p[0][1]);
-    process->transform2D(image->width,             0, p[1][0], p[1][1]);
-    process->transform2D(image->width, image->height, p[2][0], p[2][1]);
-    process->transform2D(0,            image->height, p[3][0], p[3][1]);
+    // Рабочие параметры принадлежат потоку обработки, берем их копию
+    Process::Transform2DParam trans = process->getTransform2DParam();
+
+    Process::transform2D(trans, 0,                        0, p[0][0], p[0][1]);
+    Process::transform2D(trans, image->width,             0, p[1][0], p[1][1]);
+    Process::transform2D(trans, image->width, image->height, p[2][0], p[2][1]);
+    Process::transform2D(trans, 0,            image->height, p[3][0], p[3][1]);
 
     cvLine(image, cvPoint(p[0][0], p[0][1]), cvPoint(p[1][0], p[1][1]), color, 2);
     cvLine(image, cvPoint(p[1][0], p[1][1]), cvPoint(p[2][0], p[2][1]), color, 2);
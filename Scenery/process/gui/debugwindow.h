@@ -13,7 +13,7 @@ public:
     DebugWindow(QString name, int width, int height);
     ~DebugWindow();
 
-    void show(IplImage *image, Process *process);
+    void show(const ProcessResult *result, Process *process);
 
 private:
     QString name;
@@ -22,10 +22,11 @@ private:
 
     QList<SeqAreas> seqAreasList;
     IplImage *debug;
+    IplImage *hit;
 
-    void drawAreas(IplImage *image, Areas &areas, CvScalar color, int type = 0);
-    void drawAreasReal(IplImage *image, Areas &areas, CvScalar color, int type = 0);
-    void drawSeqAreas(IplImage *image, SeqAreas &seqAreas, CvScalar color, int type = 0);
+    void drawAreas(IplImage *image, const Areas &areas, CvScalar color, int type = 0);
+    void drawAreasReal(IplImage *image, const Areas &areas, CvScalar color, int type = 0);
+    void drawSeqAreas(IplImage *image, const SeqAreas &seqAreas, CvScalar color, int type = 0);
     void drawTransform(IplImage *image, Process *process, CvScalar color);
 };
 
@@ -0,0 +1,71 @@
+#include "haarloader.h"
+
+#include <QMutexLocker>
+#include <QDebug>
+
+HaarLoader::HaarLoader()
+{
+    dirty = false;
+    stopped = false;
+    running = false;
+}
+
+HaarLoader::~HaarLoader()
+{
+    mutex.lock();
+    stopped = true;
+    mutex.unlock();
+
+    wait();
+
+    CvHaarClassifierCascade *cascade = ready.fetchAndStoreOrdered(0);
+    if (cascade)
+        cvReleaseHaarClassifierCascade(&cascade);
+}
+
+void HaarLoader::load(string file)
+{
+    QMutexLocker locker(&mutex);
+
+    this->file = file;
+    dirty = true;
+
+    if (!running) {
+        // Поток мог только что выйти из цикла, дожидаемся его завершения
+        wait();
+        running = true;
+        start(QThread::LowPriority);
+    }
+}
+
+CvHaarClassifierCascade *HaarLoader::take()
+{
+    return ready.fetchAndStoreOrdered(0);
+}
+
+void HaarLoader::run()
+{
+    forever {
+        mutex.lock();
+        if (!dirty || stopped) {
+            running = false;
+            mutex.unlock();
+            break;
+        }
+        string file = this->file;
+        dirty = false;
+        mutex.unlock();
+
+        CvHaarClassifierCascade *cascade = (CvHaarClassifierCascade *)cvLoad(file.c_str(), 0, 0, 0);
+        if (!cascade) {
+            qDebug() << "Error open cascade file:" << QString(file.c_str());
+            continue;
+        }
+        qDebug() << "Open cascade file:" << QString(file.c_str());
+
+        // Если предыдущий каскад еще не забрали, он больше не нужен
+        CvHaarClassifierCascade *old = ready.fetchAndStoreOrdered(cascade);
+        if (old)
+            cvReleaseHaarClassifierCascade(&old);
+    }
+}
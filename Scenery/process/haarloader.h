@@ -0,0 +1,44 @@
+#ifndef HAARLOADER_H
+#define HAARLOADER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QAtomicPointer>
+
+#include <opencv/cv.h>
+
+#include <string>
+
+using std::string;
+
+// Загрузка каскада Хаара в отдельном потоке: cvLoad большого xml
+// занимает сотни миллисекунд, и поток обработки не должен их ждать.
+// Загруженный каскад забирает поток обработки в начале кадра.
+class HaarLoader : public QThread
+{
+public:
+    HaarLoader();
+    ~HaarLoader();
+
+    // Запросить загрузку файла. Если загрузка уже идет,
+    // после нее будет загружен последний запрошенный файл
+    void load(string file);
+
+    // Вызывается потоком обработки: возвращает загруженный каскад
+    // и передает владение им, или 0, если нового каскада нет
+    CvHaarClassifierCascade *take();
+
+protected:
+    void run();
+
+private:
+    QMutex mutex;
+    string file;
+    bool dirty;         // Есть новый запрос
+    bool stopped;
+    bool running;
+
+    QAtomicPointer<CvHaarClassifierCascade> ready;  // Загруженный, но еще не забранный каскад
+};
+
+#endif // HAARLOADER_H
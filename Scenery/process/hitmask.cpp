@@ -0,0 +1,122 @@
+#include "hitmask.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HITMASK_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Номер младшего единичного бита, word != 0
+static inline int lowestBit(quint64 word)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(word);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, word);
+    return index;
+#else
+    int n = 0;
+    while ( !(word & 1) ) {
+        word >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+HitMask::HitMask(int width, int height)
+{
+    this->width = width;
+    this->height = height;
+    words = (width + 63) / 64;
+    bits.assign(words * height, 0);
+}
+
+void HitMask::setRow(int y, const uchar *hit)
+{
+    quint64 *dst = row(y);
+
+    for ( int w=0; w<words; w++ ) {
+        int x = w * 64;
+        int count = width - x < 64 ? width - x : 64;
+        quint64 word = 0;
+        int i = 0;
+
+#if defined(HITMASK_SSE2)
+        // Старшие биты 16 байтов одной командой
+        const __m128i zero = _mm_setzero_si128();
+        for ( ; i + 16 <= count; i += 16 ) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(hit + x + i));
+            unsigned int m = ~_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)) & 0xFFFF;
+            word |= (quint64)m << i;
+        }
+#endif
+        for ( ; i < count; i++ ) {
+            if ( hit[x + i] )
+                word |= (quint64)1 << i;
+        }
+
+        dst[w] = word;
+    }
+}
+
+void HitMask::toImage(IplImage *image) const
+{
+    for ( int y=0; y<height; y++ ) {
+        uchar* img_ptr = (uchar*) (image->imageData + y * image->widthStep);
+        const quint64 *src = row(y);
+
+        for ( int x=0; x<width; x++ ) {
+            img_ptr[x] = (src[x >> 6] >> (x & 63)) & 1 ? 255 : 0;
+        }
+    }
+}
+
+void HitMask::fromImage(IplImage *image)
+{
+    for ( int y=0; y<height; y++ ) {
+        setRow(y, (uchar*) (image->imageData + y * image->widthStep));
+    }
+}
+
+int HitMask::nextSet(int y, int x)
+{
+    if ( x >= width )
+        return width;
+
+    const quint64 *src = row(y);
+    int w = x >> 6;
+    quint64 word = src[w] & (~(quint64)0 << (x & 63));
+
+    while ( !word ) {
+        if ( ++w == words )
+            return width;
+        word = src[w];
+    }
+
+    return w * 64 + lowestBit(word);
+}
+
+int HitMask::nextClear(int y, int x)
+{
+    if ( x >= width )
+        return width;
+
+    const quint64 *src = row(y);
+    int w = x >> 6;
+    quint64 word = ~src[w] & (~(quint64)0 << (x & 63));
+
+    while ( !word ) {
+        if ( ++w == words )
+            return width;
+        word = ~src[w];
+    }
+
+    // Биты за пределами width всегда нулевые, поэтому
+    // результат не превышает width
+    return w * 64 + lowestBit(word);
+}
@@ -0,0 +1,44 @@
+#ifndef HITMASK_H
+#define HITMASK_H
+
+#include <QtGlobal>
+#include <opencv/cxcore.h>
+#include <vector>
+
+using std::vector;
+
+// Маска найденных пикселей, один бит на пиксель (64 пикселя в слове).
+// В 8 раз меньше одноканального IplImage, а отрезки отмеченных
+// пикселей ищутся сразу по целым словам
+class HitMask
+{
+public:
+    HitMask(int width, int height);
+
+    int getWidth() { return width; }
+    int getHeight() { return height; }
+    int getWords() { return words; }
+
+    quint64 *row(int y) { return &bits[y * words]; }
+    const quint64 *row(int y) const { return &bits[y * words]; }
+
+    // Упаковать строку байтов (0 - не подходит, иначе подходит)
+    void setRow(int y, const uchar *hit);
+
+    // Преобразования в одноканальное изображение 0/255 и обратно
+    void toImage(IplImage *image) const;
+    void fromImage(IplImage *image);
+
+    // Первый отмеченный / не отмеченный пиксель строки y, начиная с x.
+    // Если такого нет, возвращает width
+    int nextSet(int y, int x);
+    int nextClear(int y, int x);
+
+private:
+    int width;
+    int height;
+    int words;      // Количество слов в строке
+    vector<quint64> bits;
+};
+
+#endif // HITMASK_H
@@ -1,7 +1,11 @@
 ﻿#include "input.h"
+#include "clock.h"
+#include "tracer.h"
 #include <QDebug>
+#include <QMutexLocker>
 
-Input::Input(Device device, QString name, int width, int height)
+Input::Input(Device device, QString name, int width, int height, int consumers) :
+    captureTimer("capture")
 {
     qDebug() << "Constructor Begin: Input";
 
@@ -11,6 +15,7 @@ Input::Input(Device device, QString name, int width, int height)
     this->height = height;
 
     capture = 0;
+    synthetic = 0;
     switch (device) {
     case None:
         break;
@@ -20,19 +25,24 @@ Input::Input(Device device, QString name, int width, int height)
     case Video:
         initVideo();
         break;
+    case Replay:
+        initReplay();
+        break;
+    case Synthetic:
+        if ( this->width <= 0 || this->height <= 0 ) {
+            this->width = 640;
+            this->height = 480;
+        }
+        synthetic = new SyntheticScene(this->width, this->height);
+        truth.resize(SYNTHETIC_HISTORY);
+        break;
     }
 
-    curFrame = 0;
-    for ( int i=0; i<STORE_FRAMES; i++) {
-        arrFrame[i] = cvCreateImage( cvSize(this->width, this->height), IPL_DEPTH_8U, 3 );
-    }
-
-    frame = arrFrame[0];
+    replayRate = ReplayOriginal;
 
-    fpsRest = 0;
-    fpsFrames = 0;
-    fpsResult = 0;
-    fpsTime.start();
+    ring = new FrameRing(this->width, this->height, RING_PINNED * qMax(consumers, 1));
+    number = 0;
+    stopped = false;
 
     qDebug() << "Constructor End: Input";
 }
@@ -41,49 +51,192 @@ Input::~Input()
 {
     qDebug() << "Destructor Begin: Input";
 
+    stop();
     wait();
     if (capture) {
         cvReleaseCapture(&capture);
     }
 
-    for ( int i=0; i<STORE_FRAMES; i++) {
-        cvReleaseImage(&arrFrame[i]);
-    }
+    // Кадры Replay ссылаются на отображенный файл, поэтому
+    // он закрывается после кольца
+    delete ring;
+    replay.close();
+    delete synthetic;
 
     qDebug() << "Destructor End: Input";
 }
 
+void Input::stop()
+{
+    stopped = true;
+    ring->wakeAll();
+}
+
+void Input::setRecord(QString file)
+{
+    // Шаг строк такой же, как у буферов кольца
+    IplImage *header = cvCreateImageHeader( cvSize(width, height), IPL_DEPTH_8U, 3 );
+    recorder.open(file, width, height, header->widthStep);
+    cvReleaseImageHeader(&header);
+}
+
 void Input::run()
 {
+    Tracer::setThreadName(captureTimer.getName());
+
+    if ( device == Replay ) {
+        runReplay();
+        return;
+    }
+
+    if ( device == Synthetic ) {
+        runSynthetic();
+        return;
+    }
+
     if (!capture)
         return;
 
-    IplImage *newFrame = cvQueryFrame(capture);
-    if ( !newFrame )
+    // Поток работает все время, пока открыто устройство:
+    // захват следующего кадра идет параллельно с обработкой предыдущего
+    while (!stopped) {
+        qint64 captureStart = Clock::now();
+
+        IplImage *newFrame = cvQueryFrame(capture);
+        if ( !newFrame )
+            return;
+
+        qint64 time = Clock::now();
+        number++;
+
+        // Кадр, полученный от OpenCV, принадлежит capture и будет
+        // перезаписан следующим cvQueryFrame(), поэтому это
+        // единственная копия кадра на всем пути до сцены
+        IplImage *frame = ring->beginWrite();
+        FramePool::copy(newFrame, frame);
+        ring->endWrite(number, time);
+
+        qint64 captureTime = Clock::now() - captureStart;
+        captureTimer.add(captureTime);
+        Tracer::complete("capture", captureStart, captureTime, number);
+
+        // Записанный кадр больше не меняется, его можно читать,
+        // пока обработка работает с ним
+        if ( recorder.isOpen() ) {
+            TraceSpan span("record", number);
+            recorder.write(frame, number, time);
+        }
+
+        frameStats.add(time);
+    }
+}
+
+void Input::runReplay()
+{
+    if ( !replay.isOpen() || replay.getCount() == 0 )
         return;
 
-    curFrame++;
-    if (curFrame == STORE_FRAMES)
-        curFrame = 0;
+    // Если шаг строк в файле не совпадает с буферами кольца,
+    // кадры копируются через заголовок изображения
+    IplImage *source = cvCreateImageHeader( cvSize(width, height), IPL_DEPTH_8U, 3 );
+    bool zeroCopy = source->widthStep == replay.getWidthStep();
+
+    qint64 firstTime = replay.getRecord(0)->time;
+    qint64 start = Clock::now();
+
+    for ( int i=0; i<replay.getCount() && !stopped; i++ ) {
+        waitFrame(start, replay.getRecord(i)->time - firstTime);
 
-    frame = arrFrame[curFrame];
-    cvCopy(newFrame, frame);
+        qint64 captureStart = Clock::now();
+        number++;
 
-    fpsFrames++;
-    int fpsElapsed = fpsTime.elapsed();
+        char *data = replay.getImageData(i);
+        if (zeroCopy) {
+            ring->beginWrite(data);
+        }
+        else {
+            cvSetData(source, data, replay.getWidthStep());
+            FramePool::copy(source, ring->beginWrite());
+        }
+        ring->endWrite(number, captureStart);
 
-    if (fpsElapsed + fpsRest > 999) {
-        fpsRest = fpsElapsed + fpsRest - 999;
-        fpsResult = fpsFrames;
-        fpsFrames = 0;
-        fpsTime.restart();
+        qint64 captureTime = Clock::now() - captureStart;
+        captureTimer.add(captureTime);
+        Tracer::complete("capture", captureStart, captureTime, number);
+
+        frameStats.add(captureStart);
+    }
+
+    cvReleaseImageHeader(&source);
+}
+
+void Input::runSynthetic()
+{
+    qint64 start = Clock::now();
+
+    for ( qint64 i=0; !stopped; i++ ) {
+        waitFrame(start, i * 1000000 / SYNTHETIC_FPS);
+
+        qint64 captureStart = Clock::now();
+        number++;
+
+        // Сцена рисуется прямо в буфер кольца, без копирования
+        synthetic->render( ring->beginWrite() );
+        ring->endWrite(number, captureStart);
+
+        truthMutex.lock();
+        Truth &frameTruth = truth[number % SYNTHETIC_HISTORY];
+        frameTruth.number = number;
+        frameTruth.blobs = synthetic->getBlobs();
+        truthMutex.unlock();
+
+        qint64 captureTime = Clock::now() - captureStart;
+        captureTimer.add(captureTime);
+        Tracer::complete("capture", captureStart, captureTime, number);
+
+        frameStats.add(captureStart);
+    }
+}
+
+void Input::waitFrame(qint64 start, qint64 offset)
+{
+    if ( replayRate == ReplayOriginal ) {
+        // Ждем момента кадра относительно начала
+        qint64 delay = offset - (Clock::now() - start);
+        if ( delay > 0 )
+            usleep(delay);
+    }
+    else {
+        // Кадры не пропускаются: ждем, пока обработка возьмет предыдущий
+        while ( !ring->isLatestTaken() && !stopped )
+            usleep(100);
     }
 }
 
+void Input::setSyntheticParam(SyntheticScene::Param param)
+{
+    if (synthetic)
+        synthetic->setParam(param);
+}
+
+bool Input::getTruth(unsigned int number, vector<SyntheticScene::Blob> &blobs)
+{
+    if ( !synthetic || !number )
+        return false;
+
+    QMutexLocker locker(&truthMutex);
+    const Truth &frameTruth = truth[number % SYNTHETIC_HISTORY];
+    if ( frameTruth.number != number )
+        return false;
+
+    blobs = frameTruth.blobs;
+    return true;
+}
+
 void Input::initCamera()
 {
-    // получаем любую подключённую камеру
-    capture = cvCreateCameraCapture(CV_CAP_ANY);
+    // получаем камеру с номером name или любую подключённую
+    capture = cvCreateCameraCapture(name.isEmpty() ? CV_CAP_ANY : name.toInt());
     assert( capture );
 
     if ( !(width <= 0 || height <= 0) ) {
@@ -114,3 +267,12 @@ void Input::initVideo()
     width = realWidth;
     height = realHeight;
 }
+
+void Input::initReplay()
+{
+    if ( !replay.open(name) )
+        return;
+
+    width = replay.getWidth();
+    height = replay.getHeight();
+}
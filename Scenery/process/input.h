@@ -2,11 +2,25 @@
 #define INPUT_H
 
 #include <QThread>
+#include <QMutex>
 #include <QString>
-#include <QTime>
 #include <opencv/highgui.h>
 
-#define STORE_FRAMES 3
+#include "framefile.h"
+#include "framering.h"
+#include "framestats.h"
+#include "stagetimer.h"
+#include "synthetic.h"
+
+// Сколько кадров может одновременно держать один поток обработки:
+// обрабатываемый кадр и кадры трех результатов
+#define RING_PINNED 4
+
+// Частота кадров Synthetic в режиме ReplayOriginal
+#define SYNTHETIC_FPS 30
+
+// Для скольких последних кадров Synthetic хранятся истинные положения
+#define SYNTHETIC_HISTORY 64
 
 class Input: public QThread
 {
@@ -15,18 +29,49 @@ public:
     enum Device {
         None,
         Camera,
-        Video
+        Video,
+        Replay,     // Файл, записанный setRecord()
+        Synthetic   // Искусственная сцена (SyntheticScene)
     };
 
-    Input(Device device, QString name, int width = 0, int height = 0);
+    // name - файл для Video и Replay, номер камеры для Camera (пусто - любая).
+    // consumers - сколько потоков обработки читают кольцо этого входа
+    Input(Device device, QString name, int width = 0, int height = 0, int consumers = 1);
     ~Input();
 
-    IplImage* getFrame() { return frame; }
+    // Кольцо захваченных кадров для потоков обработки
+    FrameRing *getRing() { return ring; }
+
+    // Остановить поток захвата
+    void stop();
+
+    // Записывать все захваченные кадры в file (см. framefile.h).
+    // Вызывать до start()
+    void setRecord(QString file);
+
+    // Скорость воспроизведения Replay и Synthetic
+    enum ReplayRate {
+        ReplayOriginal,     // С интервалами, как при записи (Synthetic - SYNTHETIC_FPS)
+        ReplayFast          // Следующий кадр, как только обработка взяла предыдущий
+    };
+    void setReplayRate(ReplayRate rate) { replayRate = rate; }
+
+    // Параметры Synthetic, вызывать до start()
+    void setSyntheticParam(SyntheticScene::Param param);
+
+    // Истинные положения кругов Synthetic в кадре number.
+    // false, если кадр уже вышел из истории или это не Synthetic
+    bool getTruth(unsigned int number, vector<SyntheticScene::Blob> &blobs);
 
     int getWidth() { return width;}
     int getHeigth() { return height;}
 
-    int getFPS() { return fpsResult; }
+    // Частота, дрожание и пропуски по меткам времени захвата
+    FrameStats &getFrameStats() { return frameStats; }
+
+    // Время получения кадра с устройства и записи его в кольцо.
+    // Имя таймера - это и имя потока захвата в трассировке
+    StageTimer &getCaptureTimer() { return captureTimer; }
 
 protected:
     void run();
@@ -38,17 +83,36 @@ private:
     int height;
     CvCapture *capture;
 
-    int curFrame;
-    IplImage *arrFrame[STORE_FRAMES];
-    IplImage *frame;
+    FrameRing *ring;
+    StageTimer captureTimer;
+    unsigned int number;
+    volatile bool stopped;
 
     void initCamera();
     void initVideo();
+    void initReplay();
+
+    FrameWriter recorder;
+
+    FrameReader replay;
+    ReplayRate replayRate;
+    void runReplay();
+
+    // Ждать следующего кадра Replay или Synthetic
+    void waitFrame(qint64 start, qint64 offset);
+
+    SyntheticScene *synthetic;
+    void runSynthetic();
+
+    struct Truth {
+        unsigned int number;
+        vector<SyntheticScene::Blob> blobs;
+    };
+    QMutex truthMutex;
+    vector<Truth> truth;    // Кольцо на SYNTHETIC_HISTORY кадров
+
 
-    QTime fpsTime;
-    int fpsRest;
-    int fpsFrames;
-    int fpsResult;
+    FrameStats frameStats;
 };
 
 #endif // INPUT_H
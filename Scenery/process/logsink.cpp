@@ -0,0 +1,50 @@
+#include "logsink.h"
+
+#include <QDebug>
+#include <stdio.h>
+
+LogSink::LogSink(QString file)
+{
+    bool opened;
+    if ( file == "-" )
+        opened = this->file.open(stdout, QIODevice::WriteOnly);
+    else {
+        this->file.setFileName(file);
+        opened = this->file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    }
+
+    if (!opened)
+        qDebug() << "Error open log file:" << file;
+
+    out.setDevice(&this->file);
+}
+
+LogSink::~LogSink()
+{
+    out.flush();
+}
+
+void LogSink::write(const ProcessResult &result)
+{
+    if ( !file.isOpen() )
+        return;
+
+    int count = 0;
+    for ( unsigned int i=0; i<result.seqAreas.size(); i++ )
+        if ( result.seqAreas[i].number )
+            count++;
+
+    out << result.number << ' ' << result.latency << ' '
+        << result.areas.size() << ' ' << count;
+
+    for ( unsigned int i=0; i<result.seqAreas.size(); i++ ) {
+        const SeqArea &seqArea = result.seqAreas[i];
+        if ( !seqArea.number )
+            continue;
+
+        out << ' ' << seqArea.number << ' ' << seqArea.pt[0] << ' ' << seqArea.pt[1]
+            << ' ' << seqArea.width << ' ' << seqArea.height;
+    }
+
+    out << '\n';
+}
@@ -0,0 +1,27 @@
+#ifndef LOGSINK_H
+#define LOGSINK_H
+
+#include <QFile>
+#include <QTextStream>
+
+#include "resultsink.h"
+
+// Текстовый журнал результатов, одна строка на кадр:
+//   number latency areas seqAreas [number x y width height]...
+// Для seqAreas с number != 0. file "-" - стандартный вывод
+class LogSink : public ResultSink
+{
+public:
+    LogSink(QString file);
+    ~LogSink();
+
+    bool isOpen() { return file.isOpen(); }
+
+    void write(const ProcessResult &result);
+
+private:
+    QFile file;
+    QTextStream out;
+};
+
+#endif // LOGSINK_H
@@ -0,0 +1,181 @@
+#include "oscsink.h"
+
+#include <string.h>
+#include <math.h>
+
+// Максимум курсоров в одном пакете, чтобы датаграмма
+// гарантированно помещалась в 64 Кб (вместе с 2Dblb)
+#define TUIO_MAX_CURSORS 400
+
+OscSink::OscSink(QHostAddress host, quint16 port)
+{
+    this->host = host;
+    this->port = port;
+    socket = 0;
+    prevTime = 0;
+}
+
+OscSink::~OscSink()
+{
+    delete socket;
+}
+
+void OscSink::write(const ProcessResult &result)
+{
+    if ( result.frame.isNull() )
+        return;
+
+    if (!socket)
+        socket = new QUdpSocket();
+
+    float width = result.frame.getImage()->width;
+    float height = result.frame.getImage()->height;
+
+    // Скорость в долях кадра в секунду
+    qint64 time = result.frame.getTime();
+    float dt = prevTime && time > prevTime ? (time - prevTime) / 1000000.0f : 0;
+    prevTime = time;
+
+    int count = 0;
+    for ( unsigned int i=0; i<result.seqAreas.size() && count < TUIO_MAX_CURSORS; i++ )
+        if ( result.seqAreas[i].number )
+            count++;
+
+    bundle.clear();
+    appendString(bundle, "#bundle");
+    appendInt(bundle, 0);   // Метка времени 1 - "немедленно"
+    appendInt(bundle, 1);
+
+    appendAlive("/tuio/2Dcur", result, count);
+
+    for ( unsigned int i=0, n=0; i<result.seqAreas.size() && n < (unsigned int)count; i++ ) {
+        const SeqArea &seqArea = result.seqAreas[i];
+        if ( !seqArea.number )
+            continue;
+        n++;
+
+        float x = seqArea.pt[0] / width;
+        float y = seqArea.pt[1] / height;
+        float vx = dt > 0 ? (seqArea.pt[0] - seqArea.ptPrev[0]) / width / dt : 0;
+        float vy = dt > 0 ? (seqArea.pt[1] - seqArea.ptPrev[1]) / height / dt : 0;
+
+        beginMessage("/tuio/2Dcur", ",sifffff");
+        appendString(message, "set");
+        appendInt(message, seqArea.number);
+        appendFloat(message, x);
+        appendFloat(message, y);
+        appendFloat(message, vx);
+        appendFloat(message, vy);
+        appendFloat(message, 0);
+        endMessage();
+    }
+
+    beginMessage("/tuio/2Dcur", ",si");
+    appendString(message, "fseq");
+    appendInt(message, result.number);
+    endMessage();
+
+    // Те же треки в профиле 2Dblb: центр масс, угол главной оси,
+    // размеры и площадь региона. Скорости те же, что и в 2Dcur
+    appendAlive("/tuio/2Dblb", result, count);
+
+    float frameArea = width * height;
+    for ( unsigned int i=0, n=0; i<result.seqAreas.size() && n < (unsigned int)count; i++ ) {
+        const SeqArea &seqArea = result.seqAreas[i];
+        if ( !seqArea.number )
+            continue;
+        n++;
+
+        float vx = dt > 0 ? (seqArea.pt[0] - seqArea.ptPrev[0]) / width / dt : 0;
+        float vy = dt > 0 ? (seqArea.pt[1] - seqArea.ptPrev[1]) / height / dt : 0;
+
+        // TUIO: угол от 0 до 2pi
+        float angle = seqArea.orientation < 0 ? seqArea.orientation + 2*M_PI
+                                              : seqArea.orientation;
+
+        beginMessage("/tuio/2Dblb", ",sifffffffffff");
+        appendString(message, "set");
+        appendInt(message, seqArea.number);
+        appendFloat(message, seqArea.centroid[0] / width);
+        appendFloat(message, seqArea.centroid[1] / height);
+        appendFloat(message, angle);
+        appendFloat(message, seqArea.width / width);
+        appendFloat(message, seqArea.height / height);
+        appendFloat(message, seqArea.pixels / frameArea);
+        appendFloat(message, vx);
+        appendFloat(message, vy);
+        appendFloat(message, 0);
+        appendFloat(message, 0);
+        appendFloat(message, 0);
+        endMessage();
+    }
+
+    beginMessage("/tuio/2Dblb", ",si");
+    appendString(message, "fseq");
+    appendInt(message, result.number);
+    endMessage();
+
+    socket->writeDatagram(bundle, host, port);
+}
+
+// Сообщения source и alive профиля: номера всех найденных треков
+void OscSink::appendAlive(const char *address, const ProcessResult &result, int count)
+{
+    beginMessage(address, ",ss");
+    appendString(message, "source");
+    appendString(message, "scenery");
+    endMessage();
+
+    QByteArray types(",s");
+    types.append(QByteArray(count, 'i'));
+    beginMessage(address, types.constData());
+    appendString(message, "alive");
+    for ( unsigned int i=0, n=0; i<result.seqAreas.size() && n < (unsigned int)count; i++ ) {
+        if ( result.seqAreas[i].number ) {
+            appendInt(message, result.seqAreas[i].number);
+            n++;
+        }
+    }
+    endMessage();
+}
+
+void OscSink::beginMessage(const char *address, const char *types)
+{
+    message.clear();
+    appendString(message, address);
+    appendString(message, types);
+}
+
+void OscSink::endMessage()
+{
+    // Элемент bundle: размер сообщения и само сообщение
+    appendInt(bundle, message.size());
+    bundle.append(message);
+}
+
+// Строка OSC: символы, завершающий ноль и выравнивание до 4 байт
+void OscSink::appendString(QByteArray &data, const char *string)
+{
+    int length = strlen(string);
+    data.append(string, length);
+    data.append(QByteArray(4 - length % 4, '\0'));
+}
+
+// Числа OSC: 32 бита, старший байт первым
+void OscSink::appendInt(QByteArray &data, int value)
+{
+    unsigned int bits = value;
+    char bytes[4];
+    bytes[0] = bits >> 24;
+    bytes[1] = bits >> 16;
+    bytes[2] = bits >> 8;
+    bytes[3] = bits;
+    data.append(bytes, 4);
+}
+
+void OscSink::appendFloat(QByteArray &data, float value)
+{
+    int bits;
+    memcpy(&bits, &value, 4);
+    appendInt(data, bits);
+}
@@ -0,0 +1,47 @@
+#ifndef OSCSINK_H
+#define OSCSINK_H
+
+#include <QByteArray>
+#include <QHostAddress>
+#include <QUdpSocket>
+
+#include "resultsink.h"
+
+// Порт TUIO по умолчанию
+#define TUIO_PORT 3333
+
+// Отправляет треки (SeqAreas) по UDP в формате TUIO 1.1, профили
+// /tuio/2Dcur (центр прямоугольника) и /tuio/2Dblb (центр масс,
+// ориентация, размер и площадь): один пакет OSC bundle на кадр.
+// Координаты нормированы на размер кадра, скорость - в долях
+// кадра в секунду.
+// Регионы и контуры не отправляются, они есть в SharedSink
+class OscSink : public ResultSink
+{
+public:
+    OscSink(QHostAddress host = QHostAddress::LocalHost, quint16 port = TUIO_PORT);
+    ~OscSink();
+
+    void write(const ProcessResult &result);
+
+private:
+    QHostAddress host;
+    quint16 port;
+
+    // Сокет создается в потоке обработки при первой записи
+    QUdpSocket *socket;
+
+    QByteArray bundle;      // Буферы переиспользуются между кадрами
+    QByteArray message;
+    qint64 prevTime;        // Время захвата предыдущего кадра, мкс
+
+    void appendAlive(const char *address, const ProcessResult &result, int count);
+    void beginMessage(const char *address, const char *types);
+    void endMessage();
+
+    void appendString(QByteArray &data, const char *string);
+    void appendInt(QByteArray &data, int value);
+    void appendFloat(QByteArray &data, float value);
+};
+
+#endif // OSCSINK_H
@@ -1,10 +1,19 @@
 ﻿#include "process.h"
+#include "processsimd.h"
+#include "clock.h"
+#include "tracer.h"
 
 #include <QDebug>
+#include <QMutexLocker>
 #include <typeinfo>
+#include <math.h>
 
 Process::Process(int width, int height) :
-    ProcessFilters(width, height)
+    ProcessFilters(width, height),
+    latencyTimer("latency"),
+    hitMask(width, height),
+    results(width, height),
+    background(width, height)
 {
     qDebug() << "Constructor Begin: Process";
 
@@ -13,18 +22,46 @@ Process::Process(int width, int height) :
     this->width  = width;
     this->height = height;
 
-    timeMean = 0;
-    timeNum = 0;
+    for ( int i=0; i<StageCount; i++ ) {
+        stageTime[i] = 0;
+        stageTimers[i].setName( getStageName((Stage)i) );
+    }
+    stageStart = 0;
+
+    colorGeneration = 0;
+    colorPath = ColorPathAuto;
+    colorTableUsed = false;
+    paramChanges = 0;
+
+    input = 0;
+    stopped = false;
+
+    name = "process";
+
+    resultNumber = 0;
+    skipped = 0;
+    processed = 0;
 
     // Common
 
     image = NULL;
     grayImage = cvCreateImage( cvSize(width, height), IPL_DEPTH_8U, 1 );
-    prevImage = cvCreateImage( cvSize(width, height), IPL_DEPTH_8U, 3 );
     hitImage = cvCreateImage( cvSize(width, height), IPL_DEPTH_8U, 1 );
+    hitRows.resize(1, vector<uchar>(width));
+    hitPacked = false;
+
+    // Попиксельные фильтры и разметка отрезков делят строки
+    // между теми же потоками
+    ProcessFilters::setThreadPool(&pool);
+    Clustering::setThreadPool(&pool);
 
     // Color & Motion
 
+    // Текущие режимы до первого applyParam: с ними сравниваются новые
+    // параметры, а модель фона пока пустая
+    mode = ProcessNone;
+    motionParam.mode = MotionFrameDiff;
+
     // Haar
 
     haarCascade = 0;
@@ -39,20 +76,6 @@ Process::Process(int width, int height) :
 
     houghCirclesStorage = cvCreateMemStorage(0);
 
-    // Transform
-
-    trans2D.mx = 0;
-    trans2D.my = 0;
-    trans2D.sx = 1;
-    trans2D.sy = 1;
-    trans2D.theta = 0;
-    trans2D.g = 0;
-    trans2D.h = 0;
-
-    trans2D.deepHx = 0;
-    trans2D.deepHy = width/2;
-    trans2D.deepHs = 0.0;
-
     setDefaultParam();
 
     qDebug() << "Constructor End: Process";
@@ -62,11 +85,15 @@ Process::~Process()
 {
     qDebug() << "Destructor Begin: Process";
 
+    stop();
     wait();
 
     cvReleaseImage(&hitImage);
     cvReleaseImage(&grayImage);
 
+    if (haarCascade)
+        cvReleaseHaarClassifierCascade(&haarCascade);
+
     cvReleaseMemStorage(&haarStorage);
     cvReleaseMemStorage(&contourStorage);
 
@@ -78,47 +105,77 @@ Process::~Process()
 
 void Process::setDefaultParam()
 {
-    setMode(ProcessColor);
+    // Вызывается из конструктора, поток обработки еще не запущен
+    pending.mode = ProcessColor;
+    pending.packedMask = true;
+    pending.publishHitMask = false;
+    pending.threads = 1;
 
     // Color
-    colorRangeMode = AllRange;
-    colorRangeParam.invert = false;
-    colorRangeParam.Hmin = 0;
-    colorRangeParam.Hmax = 50;
-    colorRangeParam.Smin = 50;
-    colorRangeParam.Smax = 255;
-    colorRangeParam.Vmin = 50;
-    colorRangeParam.Vmax = 255;
+    pending.colorRangeMode = AllRange;
+    pending.colorRangeParam.invert = false;
+    pending.colorRangeParam.Hmin = 0;
+    pending.colorRangeParam.Hmax = 50;
+    pending.colorRangeParam.Smin = 50;
+    pending.colorRangeParam.Smax = 255;
+    pending.colorRangeParam.Vmin = 50;
+    pending.colorRangeParam.Vmax = 255;
+    pending.colorGeneration = 0;
+    pending.colorPath = ColorPathAuto;
+    updateColorTable();
 
     // Motion
-    motionParam.sensitivity = 100;
+    pending.motionParam.mode = MotionFrameDiff;
+    pending.motionParam.sensitivity = 100;
+    pending.motionParam.learnShift = 5;
 
     // Haar
-    haarParam.scaleFactor = 1.1;
-    haarParam.minSizeX = 120;
-    haarParam.minSizeY = 120;
-    haarParam.maxSizeX = 0;
-    haarParam.maxSizeY = 0;
+    pending.haarParam.scaleFactor = 1.1;
+    pending.haarParam.minSizeX = 120;
+    pending.haarParam.minSizeY = 120;
+    pending.haarParam.maxSizeX = 0;
+    pending.haarParam.maxSizeY = 0;
     //setHaarFile("haarcascades/haarcascade_frontalface_default.xml");
 
     // Contour
-    contourParam.threshold1 = 10;
-    contourParam.threshold2 = 100;
+    pending.contourParam.threshold1 = 10;
+    pending.contourParam.threshold2 = 100;
 
     // HoughCircles
 
-    houghCirclesParam.inverseRatio = 5;
-    houghCirclesParam.minDistance = 100;
-    houghCirclesParam.param1 = 100;
-    houghCirclesParam.param2 = 100;
-    houghCirclesParam.minRadius = 0;
-    houghCirclesParam.maxRadius = 0;
+    pending.houghCirclesParam.inverseRatio = 5;
+    pending.houghCirclesParam.minDistance = 100;
+    pending.houghCirclesParam.param1 = 100;
+    pending.houghCirclesParam.param2 = 100;
+    pending.houghCirclesParam.minRadius = 0;
+    pending.houghCirclesParam.maxRadius = 0;
 
     // Sequences
-    seqAreaParam.count = 1;
-    seqAreaParam.lenghtLimit = 1000;
+    pending.seqAreaParam.count = 1;
+    pending.seqAreaParam.lenghtLimit = 1000;
 
-    filterSeqAreaParam.buffSize = 0;
+    pending.filterSeqAreaParam.buffSize = 0;
+
+    // Transform
+    pending.trans2D.mx = 0;
+    pending.trans2D.my = 0;
+    pending.trans2D.sx = 1;
+    pending.trans2D.sy = 1;
+    pending.trans2D.theta = 0;
+    pending.trans2D.g = 0;
+    pending.trans2D.h = 0;
+
+    pending.trans2D.deepHx = 0;
+    pending.trans2D.deepHy = width/2;
+    pending.trans2D.deepHs = 0.0;
+
+    // Clustering - значения по умолчанию из конструктора Clustering
+    pending.clusterMode = getClusterMode();
+    pending.simpleClusterParam = getSimpleClusterParam();
+    pending.tableClusterParam = getTableClusterParam();
+
+    paramChanges = ParamChanged | ParamSeqAreaChanged;
+    applyParam();
 
     //seqAreasBuffer.resize(1);
 
@@ -130,10 +187,66 @@ void Process::setDefaultParam()
 
 }
 
+void Process::applyParam()
+{
+    CvHaarClassifierCascade *cascade = haarLoader.take();
+    if (cascade) {
+        if (haarCascade)
+            cvReleaseHaarClassifierCascade(&haarCascade);
+        haarCascade = cascade;
+    }
+
+    // Параметры меняются редко, обычно мьютекс не нужен
+    if (!paramChanges)
+        return;
+
+    paramMutex.lock();
+    Param param = pending;
+    int changes = paramChanges;
+    paramChanges = 0;
+    paramMutex.unlock();
+
+    // Модель фона начинается заново с первого кадра после
+    // переключения на нее
+    if (param.mode != mode || param.motionParam.mode != motionParam.mode)
+        background.clear();
+
+    mode = param.mode;
+    packedMask = param.packedMask;
+    publishHitMask = param.publishHitMask;
+
+    pool.setThreadCount(param.threads);
+    hitRows.resize(pool.getThreadCount(), vector<uchar>(width));
+
+    colorRangeMode = param.colorRangeMode;
+    colorRangeParam = param.colorRangeParam;
+    colorGeneration = param.colorGeneration;
+    colorPath = param.colorPath;
+
+    motionParam = param.motionParam;
+    haarParam = param.haarParam;
+    contourParam = param.contourParam;
+    houghCirclesParam = param.houghCirclesParam;
+
+    seqAreaParam = param.seqAreaParam;
+    filterSeqAreaParam = param.filterSeqAreaParam;
+    if (changes & ParamSeqAreaChanged)
+        seqAreasBuffer.clear();
+
+    trans2D = param.trans2D;
+
+    Clustering::setClusterMode(param.clusterMode);
+    Clustering::setSimpleClusterParam(param.simpleClusterParam);
+    Clustering::setTableClusterParam(param.tableClusterParam);
+}
+
 void Process::step()
 {
-    QTime time;
-    time.start();
+    applyParam();
+
+    for ( int i=0; i<StageCount; i++ )
+        stageTime[i] = 0;
+    stageStart = Clock::now();
 
     switch (mode) {
     case ProcessNone:
@@ -141,106 +254,381 @@ void Process::step()
 
     case ProcessColor:
         findColor();
-        findClusters(hitImage, areas);
+        endStage(StageDetect);
+        findHitClusters();
+        endStage(StageCluster);
         transform2DAreas(areas);
+        endStage(StageTransform);
         findSeqAreas(areas, seqAreas);
+        endStage(StageSeqAreas);
         filterSeqAreas(seqAreas, seqAreasBuffer);
+        endStage(StageFilter);
         break;
 
     case ProcessMotion:
         findMotion();
-        findClusters(hitImage, areas);
+        endStage(StageDetect);
+        findHitClusters();
+        endStage(StageCluster);
         transform2DAreas(areas);
+        endStage(StageTransform);
         findSeqAreas(areas, seqAreas);
+        endStage(StageSeqAreas);
         filterSeqAreas(seqAreas, seqAreasBuffer);
-        cvCopy(image, prevImage);
+        endStage(StageFilter);
+        prevFrame = frame;
         break;
 
     case ProcessHaar:
         findHaar();
+        endStage(StageDetect);
         findSeqAreas(areas, seqAreas);
+        endStage(StageSeqAreas);
         filterSeqAreas(seqAreas, seqAreasBuffer);
+        endStage(StageFilter);
         break;
 
     case ProcessContour:
         findContours();
-        findClusters(hitImage, areas);
+        endStage(StageDetect);
+        findHitClusters();
+        endStage(StageCluster);
         transform2DAreas(areas);
+        endStage(StageTransform);
         findSeqAreas(areas, seqAreas);
+        endStage(StageSeqAreas);
         filterSeqAreas(seqAreas, seqAreasBuffer);
+        endStage(StageFilter);
         break;
 
     case ProcessHoughCircles:
         findHoughCircles();
+        endStage(StageDetect);
         findSeqAreas(areas, seqAreas);
+        endStage(StageSeqAreas);
         filterSeqAreas(seqAreas, seqAreasBuffer);
+        endStage(StageFilter);
         break;
 
     }
 
-    timeMean += time.elapsed();
-    timeNum++;
+}
 
-    if ( timeNum == 10 ) {
-        //qDebug() << "Process time:" << timeMean/10;
-        timeMean = 0;
-        timeNum = 0;
-    }
+void Process::endStage(Stage stage)
+{
+    qint64 now = Clock::now();
+    stageTime[stage] += now - stageStart;
+    stageTimers[stage].add(now - stageStart);
+    Tracer::complete(getStageName(stage), stageStart, now - stageStart, frame.getNumber());
+    stageStart = now;
+}
+
+const char *Process::getStageName(Stage stage)
+{
+    static const char *names[StageCount] = {
+        "detect",
+        "cluster",
+        "transform",
+        "seqAreas",
+        "filter"
+    };
+    return names[stage];
+}
+
+void Process::setName(QString name)
+{
+    this->name = name;
+    pool.setName(name);
 
+    QString prefix = name.isEmpty() ? "" : name + ".";
+    for ( int i=0; i<StageCount; i++ )
+        stageTimers[i].setName( prefix + getStageName((Stage)i) );
+    latencyTimer.setName(prefix + "latency");
 }
 
-void Process::setImage(IplImage *image)
+void Process::setFrame(const Frame &frame)
 {
-    assert(image);
-    assert(image->width == width && image->height == height);
-    this->image = image;
+    assert(!frame.isNull());
+    assert(frame.getImage()->width == width && frame.getImage()->height == height);
+    this->frame = frame;
+    this->image = frame.getImage();
 }
 
-void Process::setHaarFile(string file)
+void Process::setMode(Process::Mode mode)
 {
-    wait();
+    QMutexLocker locker(&paramMutex);
+    pending.mode = mode;
+    paramChanges |= ParamChanged;
+}
+
+Process::Mode Process::getMode()
+{
+    QMutexLocker locker(&paramMutex);
+    return pending.mode;
+}
+
+void Process::setPackedMask(bool packed)
+{
+    QMutexLocker locker(&paramMutex);
+    pending.packedMask = packed;
+    paramChanges |= ParamChanged;
+}
 
+bool Process::isPackedMask()
+{
+    QMutexLocker locker(&paramMutex);
+    return pending.packedMask;
+}
+
+void Process::setPublishHitMask(bool publish)
+{
+    QMutexLocker locker(&paramMutex);
+    pending.publishHitMask = publish;
+    paramChanges |= ParamChanged;
+}
+
+bool Process::isPublishHitMask()
+{
+    QMutexLocker locker(&paramMutex);
+    return pending.publishHitMask;
+}
+
+void Process::setThreadCount(int threads)
+{
+    QMutexLocker locker(&paramMutex);
+    pending.threads = qMax(1, threads);
+    paramChanges |= ParamChanged;
+}
+
+int Process::getThreadCount()
+{
+    QMutexLocker locker(&paramMutex);
+    return pending.threads;
+}
+
+void Process::setColorRangeMode(Process::ColorRangeMode mode)
+{
+    QMutexLocker locker(&paramMutex);
+    pending.colorRangeMode = mode;
+    paramChanges |= ParamChanged;
+}
+
+Process::ColorRangeMode Process::getColorRangeMode()
+{
+    QMutexLocker locker(&paramMutex);
+    return pending.colorRangeMode;
+}
+
+void Process::setColorRangeParam(Process::ColorRangeParam param)
+{
+    QMutexLocker locker(&paramMutex);
+    pending.colorRangeParam = param;
+    updateColorTable();
+    paramChanges |= ParamChanged;
+}
+
+Process::ColorRangeParam Process::getColorRangeParam()
+{
+    QMutexLocker locker(&paramMutex);
+    return pending.colorRangeParam;
+}
+
+void Process::setColorPath(Process::ColorPath path)
+{
+    QMutexLocker locker(&paramMutex);
+    pending.colorPath = path;
+    paramChanges |= ParamChanged;
+}
+
+Process::ColorPath Process::getColorPath()
+{
+    QMutexLocker locker(&paramMutex);
+    return pending.colorPath;
+}
+
+void Process::updateColorTable()
+{
+    ProcessSimd::ColorRange range = ProcessSimd::colorRange(pending.colorRangeParam.invert,
+                                                            pending.colorRangeParam.Hmin,
+                                                            pending.colorRangeParam.Hmax,
+                                                            pending.colorRangeParam.Smin,
+                                                            pending.colorRangeParam.Vmin);
+    pending.colorGeneration++;
+    colorTable.build(range, pending.colorGeneration);
+}
+
+void Process::setMotionParam(Process::MotionParam param)
+{
+    QMutexLocker locker(&paramMutex);
+    pending.motionParam = param;
+    paramChanges |= ParamChanged;
+}
+
+Process::MotionParam Process::getMotionParam()
+{
+    QMutexLocker locker(&paramMutex);
+    return pending.motionParam;
+}
+
+void Process::setHaarFile(string file)
+{
     if ( file == "" )
         return;
 
-    if (haarCascade) {
-        cvReleaseHaarClassifierCascade(&haarCascade);
-    }
-
-    haarCascade = (CvHaarClassifierCascade *)cvLoad(file.c_str(), 0, 0, 0);
-    if (!haarCascade)
-        qDebug() << "Error open cascade file:" << QString(file.c_str());
-    else
-        qDebug() << "Open cascade file:" << QString(file.c_str());
+    haarLoader.load(file);
 }
 
 void Process::setHaarParam(Process::HaarParam param)
 {
-    haarParam = param;
-    if ( !(haarParam.scaleFactor > 1.01) ) {
-        haarParam.scaleFactor = 1.1;
+    if ( !(param.scaleFactor > 1.01) ) {
+        param.scaleFactor = 1.1;
     }
+
+    QMutexLocker locker(&paramMutex);
+    pending.haarParam = param;
+    paramChanges |= ParamChanged;
 }
 
 void Process::setContourParam(Process::ContourParam param)
 {
-    contourParam = param;
+    QMutexLocker locker(&paramMutex);
+    pending.contourParam = param;
+    paramChanges |= ParamChanged;
+}
+
+void Process::setHoughCircleParam(Process::HoughCirclesParam param)
+{
+    QMutexLocker locker(&paramMutex);
+    pending.houghCirclesParam = param;
+    paramChanges |= ParamChanged;
 }
 
 void Process::setSeqAreaParam(Process::SeqAreaParam param)
 {
-    seqAreaParam = param;
-    seqAreasBuffer.clear();
+    QMutexLocker locker(&paramMutex);
+    pending.seqAreaParam = param;
+    paramChanges |= ParamChanged | ParamSeqAreaChanged;
 }
 
 void Process::setFilterSeqAreaParam(Process::FilterSeqAreaParam param)
 {
-    filterSeqAreaParam = param;
+    QMutexLocker locker(&paramMutex);
+    pending.filterSeqAreaParam = param;
+    paramChanges |= ParamChanged;
+}
+
+void Process::setTransform2DParam(Process::Transform2DParam param)
+{
+    QMutexLocker locker(&paramMutex);
+    pending.trans2D = param;
+    paramChanges |= ParamChanged;
+}
+
+Process::Transform2DParam Process::getTransform2DParam()
+{
+    QMutexLocker locker(&paramMutex);
+    return pending.trans2D;
+}
+
+void Process::setClusterMode(Clustering::ClusterMode mode)
+{
+    QMutexLocker locker(&paramMutex);
+    pending.clusterMode = mode;
+    paramChanges |= ParamChanged;
+}
+
+void Process::setSimpleClusterParam(Clustering::SimpleClusterParam param)
+{
+    QMutexLocker locker(&paramMutex);
+    pending.simpleClusterParam = param;
+    paramChanges |= ParamChanged;
+}
+
+void Process::setTableClusterParam(Clustering::TableClusterParam param)
+{
+    QMutexLocker locker(&paramMutex);
+    pending.tableClusterParam = param;
+    paramChanges |= ParamChanged;
+}
+
+void Process::stop()
+{
+    stopped = true;
+    if (input)
+        input->wakeAll();
 }
 
 void Process::run()
 {
-    step();
+    if (!input)
+        return;
+
+    Tracer::setThreadName(name);
+
+    while (!stopped) {
+        unsigned int number = resultNumber;
+        {
+            TraceSpan span("wait", number + 1);
+            if ( !input->wait(number, 100) )
+                continue;
+        }
+
+        Frame frame;
+        if ( !input->acquire(frame, number) )
+            continue;
+
+        if (number)
+            skipped += frame.getNumber() - number - 1;
+
+        TraceSpan span("process", frame.getNumber());
+
+        setFrame(frame);
+        step();
+
+        const ProcessResult *result;
+        {
+            TraceSpan publishSpan("result", frame.getNumber());
+            result = publish(frame);
+        }
+
+        // Опубликованный результат не изменится до следующего publish()
+        // этого же потока, поэтому получатели читают его без копии
+        if ( !sinks.empty() ) {
+            TraceSpan sinkSpan("sink", frame.getNumber());
+            for ( unsigned int i=0; i<sinks.size(); i++ )
+                sinks[i]->write(*result);
+        }
+    }
+}
+
+const ProcessResult *Process::publish(const Frame &frame)
+{
+    ProcessResult *result = results.getBack();
+
+    // Буферы результата уже выделены на прошлых кадрах,
+    // присваивание только копирует данные
+    result->areas = areas;
+    result->seqAreas = *seqAreasResult;
+    result->contours = contours;
+
+    // Маска в результате устаревает, пока ее никто не читает
+    if (publishHitMask) {
+        if (hitPacked)
+            result->hitMask = hitMask;
+        else
+            result->hitMask.fromImage(hitImage);
+    }
+
+    result->frame = frame;
+    result->number = frame.getNumber();
+    result->latency = Clock::now() - frame.getTime();
+    latencyTimer.add(result->latency);
+
+    results.publish();
+    resultNumber = result->number;
+    processed++;
+
+    return result;
 }
 
 void Process::findColor()
@@ -248,99 +636,150 @@ void Process::findColor()
     // Очищаем список структур Area от предыдущего использования
     areas.clear();
 
-    // Поиск цветов и регионов
-    int xStep = 1;
+    hitPacked = packedMask;
 
-    for( int y=0; y<height; y+=1 ) {
+    // Если таблица для текущих параметров уже построена,
+    // проверка пикселя - это проверка одного бита. Ядро AVX2
+    // быстрее и таблицы: 32 пикселя за раз, без случайных чтений 2 Мб
+    bool useTable = colorPath == ColorPathTable
+                 || ( colorPath == ColorPathAuto && ProcessSimd::instructions() != ProcessSimd::AVX2 );
+    const ColorTable::Table *table = useTable ? colorTable.take() : 0;
+
+    colorTableUsed = table && table->generation == colorGeneration;
+    if (colorTableUsed) {
+        rowsColorTable = table;
+        pool.parallelFor(height, this, &Process::findColorTableRows);
+        return;
+    }
+
+    // Пока таблица строится, условие считается напрямую
+    // по RGB сразу для 16-32 пикселей (см. ProcessSimd)
+    rowsColorRange = ProcessSimd::colorRange(colorRangeParam.invert,
+                                             colorRangeParam.Hmin,
+                                             colorRangeParam.Hmax,
+                                             colorRangeParam.Smin,
+                                             colorRangeParam.Vmin);
+
+    pool.parallelFor(height, this, &Process::findColorRows);
+}
+
+void Process::findColorTableRows(int begin, int end, int thread)
+{
+    for( int y=begin; y<end; y+=1 ) {
 
         // Получаем указатели на начало строки 'y'
         uchar* img_ptr = (uchar*) (image->imageData + y * image->widthStep);
-        uchar* hit_ptr = (uchar*) (hitImage->imageData + y * hitImage->widthStep);
+        uchar* hit_ptr = beginHitRow(y, thread);
+
+        for( int x=0; x<width; x+=1 ) {
+            hit_ptr[x] = rowsColorTable->test(img_ptr[3*x+2], img_ptr[3*x+1], img_ptr[3*x+0]) ? 255 : 0;
+        }
 
-        for( int x=0; x<width; x+=xStep ) {
+        endHitRow(y, thread);
+    }
+}
 
-            xStep = 1;
-            hit_ptr[x] = 0;
+void Process::findColorRows(int begin, int end, int thread)
+{
+    for( int y=begin; y<end; y+=1 ) {
 
-            unsigned char r = img_ptr[3*x+2];
-            unsigned char g = img_ptr[3*x+1];
-            unsigned char b = img_ptr[3*x+0];
+        // Получаем указатели на начало строки 'y'
+        uchar* img_ptr = (uchar*) (image->imageData + y * image->widthStep);
+        uchar* hit_ptr = beginHitRow(y, thread);
 
-            int ss = r*256*256 + g*256 + b;
+        ProcessSimd::findColor(img_ptr, hit_ptr, width, rowsColorRange);
 
-            /*
-            Условие:
-            if( i >= min && i <= max )
-            Можно заменить таким:
-            if( (u32)(i-min) <= (u32)max - min )
-              */
+        endHitRow(y, thread);
+    }
+}
 
+void Process::findMotion()
+{
+    // Очищаем список структур Area от предыдущего использования
+    areas.clear();
+
+    hitPacked = packedMask;
 
-            /* Проверка условия в человеко-понятной форме
+    switch (motionParam.mode) {
+    case MotionFrameDiff:
+        findMotionDiff();
+        break;
+    case MotionBackground:
+        findMotionBackground();
+        break;
+    }
+}
 
-            bool h = *((unsigned char *)(HTable + ss)) >= colorRangeParam.Hmin &&
-                      *((unsigned char *)(HTable + ss)) <= colorRangeParam.Hmax;
-            bool s = *((unsigned char *)(STable + ss)) >= colorRangeParam.Smin;
-            bool v = *((unsigned char *)(VTable + ss)) >= colorRangeParam.Vmin;
-            bool invert = colorRangeParam.invert;
+void Process::findMotionDiff()
+{
+    // На первом кадре сравнивать не с чем, движения нет
+    rowsPrevImage = prevFrame.isNull() ? image : prevFrame.getImage();
 
-            bool result = (h ^ invert) && v && s;
+    pool.parallelFor(height, this, &Process::findMotionDiffRows);
+}
 
-            */
+void Process::findMotionDiffRows(int begin, int end, int thread)
+{
+    for( int y=begin; y<end; y+=1 ) {
 
+        // Получаем указатели на начало строки 'y',
+        // у каждого изображения свой widthStep
+        uchar* img_ptr = (uchar*) (image->imageData + y * image->widthStep);
+        uchar* prv_img_ptr = (uchar*) (rowsPrevImage->imageData + y * rowsPrevImage->widthStep);
+        uchar* hit_ptr = beginHitRow(y, thread);
 
-            if (
-                 (
-                   (
-                     *((unsigned char *)(HTable + ss)) >= colorRangeParam.Hmin
-                     &&
-                     *((unsigned char *)(HTable + ss)) <= colorRangeParam.Hmax
-                   )
-                   ^
-                   colorRangeParam.invert
-                 )
-                 &&
-                 *((unsigned char *)(STable + ss)) >= colorRangeParam.Smin
-                 &&
-                 *((unsigned char *)(VTable + ss)) >= colorRangeParam.Vmin
-               )
-            {
-                hit_ptr[x] = 255;
-                xStep = 1;
-            }
+        ProcessSimd::findMotion(img_ptr, prv_img_ptr, hit_ptr, width, motionParam.sensitivity);
 
-        }
+        endHitRow(y, thread);
     }
 }
 
-void Process::findMotion()
+void Process::findMotionBackground()
 {
-    // Очищаем список структур Area от предыдущего использования
-    areas.clear();
+    // На первом кадре модель равна кадру, движения нет
+    if (background.isEmpty())
+        background.reset(image);
 
-    for( int y=0; y<height; y+=1 ) {
+    rowsBackgroundParam.sensitivity = motionParam.sensitivity;
+    rowsBackgroundParam.shift = qBound(1, motionParam.learnShift, 8);
 
-        // Получаем указатели на начало строки 'y'
+    pool.parallelFor(height, this, &Process::findMotionBackgroundRows);
+}
+
+void Process::findMotionBackgroundRows(int begin, int end, int thread)
+{
+    for( int y=begin; y<end; y+=1 ) {
         uchar* img_ptr = (uchar*) (image->imageData + y * image->widthStep);
-        uchar* prv_img_ptr = (uchar*) (prevImage->imageData + y * image->widthStep);
-        uchar* hit_ptr = (uchar*) (hitImage->imageData + y * hitImage->widthStep);
+        uchar* hit_ptr = beginHitRow(y, thread);
 
-        for( int x=0; x<width; x+=1 ) {
+        ProcessSimd::findBackground(img_ptr, background.row(y), background.getStep(),
+                                    hit_ptr, width, rowsBackgroundParam);
 
-            hit_ptr[x] = 0;
+        endHitRow(y, thread);
+    }
+}
 
-            //uchar a = rgb2gray(img_ptr[3*x+2], img_ptr[3*x+1], img_ptr[3*x+0]);
-            //uchar b = rgb2gray(prv_img_ptr[3*x+2], prv_img_ptr[3*x+1], prv_img_ptr[3*x+0]);
+uchar *Process::beginHitRow(int y, int thread)
+{
+    if (packedMask)
+        return &hitRows[thread][0];
 
-            int dr = abs(img_ptr[3*x+2] - prv_img_ptr[3*x+2]);
-            int dg = abs(img_ptr[3*x+1] - prv_img_ptr[3*x+1]);
-            int db = abs(img_ptr[3*x+0] - prv_img_ptr[3*x+0]);
+    return (uchar*) (hitImage->imageData + y * hitImage->widthStep);
+}
 
-            if ( dr+dg+db > motionParam.sensitivity ) {
-                hit_ptr[x] = 255;
-            }
-        }
-    }
+void Process::endHitRow(int y, int thread)
+{
+    // Строки маски не пересекаются, потоки пишут в нее без блокировок
+    if (packedMask)
+        hitMask.setRow(y, &hitRows[thread][0]);
+}
+
+void Process::findHitClusters()
+{
+    if (hitPacked)
+        findClusters(hitMask, areas);
+    else
+        findClusters(hitImage, areas);
 }
 
 void Process::findSeqAreas(Areas &areas, SeqAreas &seqAreas)
@@ -451,6 +890,7 @@ void Process::findSeqAreas(Areas &areas, SeqAreas &seqAreas)
             newArea.height = areas.at(iMin).height;
             newArea.widthReal  = areas.at(iMin).width;
             newArea.heightReal = areas.at(iMin).height;
+            copyMoments(newArea, areas.at(iMin));
             newArea.length = m[iMin][jMin];
 
             // Найдем угол линии с предыдущей точкой
@@ -481,6 +921,7 @@ void Process::findSeqAreas(Areas &areas, SeqAreas &seqAreas)
 
                     newArea.width = areas.at(i).width;
                     newArea.height = areas.at(i).height;
+                    copyMoments(newArea, areas.at(i));
                     newArea.length = 0;
                     newArea.angle = 0;
 
@@ -504,6 +945,18 @@ void Process::findSeqAreas(Areas &areas, SeqAreas &seqAreas)
     seqAreasResult = &seqAreas;
 }
 
+void Process::copyMoments(SeqArea &seqArea, const Area &area)
+{
+    seqArea.pixels = area.pixels;
+    seqArea.centroid[0] = area.centroid[0];
+    seqArea.centroid[1] = area.centroid[1];
+    seqArea.centroidReal[0] = area.centroidReal[0];
+    seqArea.centroidReal[1] = area.centroidReal[1];
+    seqArea.orientation = area.orientation;
+    seqArea.majorAxisReal = area.majorAxisReal;
+    seqArea.minorAxisReal = area.minorAxisReal;
+}
+
 void Process::filterSeqAreas(SeqAreas &seqAreas, SeqAreasBuffer &seqAreasBuffer)
 {
     if ( filterSeqAreaParam.buffSize == 0 )
@@ -556,6 +1009,17 @@ void Process::filterSeqAreas(SeqAreas &seqAreas, SeqAreasBuffer &seqAreasBuffer)
                 curr.widthReal = ( prev.widthReal + next.widthReal ) / 2;
                 curr.heightReal = ( prev.heightReal + next.heightReal ) / 2;
 
+                curr.pixels = ( prev.pixels + next.pixels ) / 2;
+                curr.centroid[0] = ( prev.centroid[0] + next.centroid[0] ) / 2;
+                curr.centroid[1] = ( prev.centroid[1] + next.centroid[1] ) / 2;
+                curr.centroidReal[0] = ( prev.centroidReal[0] + next.centroidReal[0] ) / 2;
+                curr.centroidReal[1] = ( prev.centroidReal[1] + next.centroidReal[1] ) / 2;
+                curr.majorAxisReal = ( prev.majorAxisReal + next.majorAxisReal ) / 2;
+                curr.minorAxisReal = ( prev.minorAxisReal + next.minorAxisReal ) / 2;
+                // Ориентация определена по модулю pi, среднее
+                // двух углов может указать поперек оси
+                curr.orientation = prev.orientation;
+
                 curr.length = ( prev.length + next.length ) / 2;
                 curr.angle = ( prev.angle + next.angle ) / 2;
 
@@ -579,6 +1043,11 @@ void Process::filterSeqAreas(SeqAreas &seqAreas, SeqAreasBuffer &seqAreasBuffer)
                 curr.height = ( prev.height + curr.height + next.height ) / 3;
                 curr.widthReal = ( prev.widthReal + curr.widthReal + next.widthReal ) / 3;
                 curr.heightReal = ( prev.heightReal + curr.heightReal + next.heightReal ) / 3;
+
+                curr.centroid[0] = ( prev.centroid[0] + curr.centroid[0] + next.centroid[0] ) / 3;
+                curr.centroid[1] = ( prev.centroid[1] + curr.centroid[1] + next.centroid[1] ) / 3;
+                curr.centroidReal[0] = ( prev.centroidReal[0] + curr.centroidReal[0] + next.centroidReal[0] ) / 3;
+                curr.centroidReal[1] = ( prev.centroidReal[1] + curr.centroidReal[1] + next.centroidReal[1] ) / 3;
             }
 
         }
@@ -614,6 +1083,7 @@ void Process::findHaar()
         area.pt[1] = rect->y + rect->height/2;
         area.width = rect->width;
         area.height = rect->height;
+        setRectMoments(area);
         areas.push_back(area);
     }
 }
@@ -630,6 +1100,8 @@ void Process::findContours()
 //        cvSmooth(grayImage, grayImage, CV_BLUR, 3, 3);
 //    }
 
+    // cvFindContours работает только с одноканальным изображением
+    hitPacked = false;
     cvCanny(grayImage, hitImage, contourParam.threshold1, contourParam.threshold2, 3);
 
     // находим контуры
@@ -732,14 +1204,32 @@ void Process::findHoughCircles()
         area.pt[1] = p[1];
         area.width = p[2];
         area.height = p[2];
+        setRectMoments(area);
         areas.push_back(area);
     }
 
 }
 
+// Haar и HoughCircles не дают маски точек: центр масс - центр
+// прямоугольника, оси - его стороны. Эти алгоритмы работают
+// без 2D-преобразования, поэтому centroidReal совпадает с centroid
+void Process::setRectMoments(Area &area)
+{
+    area.pixels = 0;
+    area.centroid[0] = area.pt[0];
+    area.centroid[1] = area.pt[1];
+    area.centroidReal[0] = area.pt[0];
+    area.centroidReal[1] = area.pt[1];
+    area.orientation = area.height > area.width ? M_PI/2 : 0;
+    area.majorAxisReal = qMax(area.width, area.height);
+    area.minorAxisReal = qMin(area.width, area.height);
+}
+
 void Process::transform2DArea(Area &area)
 {
     transform2DContrary(area.ptReal[0], area.ptReal[1], area.pt[0], area.pt[1]);
+    transform2DContrary(qRound(area.centroidReal[0]), qRound(area.centroidReal[1]),
+                        area.centroid[0], area.centroid[1]);
     area.width = area.widthReal/trans2D.sx;
     area.height = area.heightReal/trans2D.sy;
     area.height -= area.height * (trans2D.deepHx - area.ptReal[0]) * trans2D.deepHs;
@@ -776,7 +1266,7 @@ void Process::transform2DAreas(Areas &areas)
  *  1     ( 0      0      1 )   ( 1  )
  *
  */
-void Process::transform2D(int px, int py, int &qx, int &qy)
+void Process::transform2D(const Transform2DParam &trans2D, int px, int py, int &qx, int &qy)
 {
     qx = trans2D.sx * px;
     qy = trans2D.sy * py;
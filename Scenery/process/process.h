@@ -1,11 +1,20 @@
 ﻿#ifndef PROCESS_H
 #define PROCESS_H
 
+#include "background.h"
 #include "clustering.h"
+#include "colortable.h"
+#include "framering.h"
+#include "haarloader.h"
 #include "processdata.h"
 #include "processfilters.h"
+#include "processresult.h"
+#include "resultsink.h"
+#include "stagetimer.h"
+#include "threadpool.h"
 
 #include <QThread>
+#include <QMutex>
 #include <QTime>
 
 #include <opencv/cxcore.h>
@@ -31,6 +40,37 @@ public:
 
     void step();
 
+    // Этапы обработки кадра в step()
+    enum Stage {
+        StageDetect,     // Поиск точек или объектов на изображении
+        StageCluster,    // Объединение точек в регионы
+        StageTransform,  // transform2DAreas
+        StageSeqAreas,   // findSeqAreas
+        StageFilter,     // filterSeqAreas
+        StageCount
+    };
+
+    // Длительность этапа на последнем кадре, мкс
+    qint64 getStageTime(Stage stage) { return stageTime[stage]; }
+
+    // Длительности этапа за последние кадры
+    StageTimer &getStageTimer(Stage stage) { return stageTimers[stage]; }
+    static const char *getStageName(Stage stage);
+
+    // Имя потока обработки в таймерах и трассировке. Когда потоков
+    // несколько, таймеры этапов называются "name.detect" и т.д.
+    void setName(QString name);
+    QString getName() { return name; }
+
+    // Поток обработки работает постоянно: берет последний кадр
+    // из кольца input, обрабатывает и публикует результат.
+    //
+    // Все set*Param вызываются из потока GUI и пишут в отложенную копию
+    // параметров. Поток обработки забирает ее целиком в начале кадра,
+    // так что кадр всегда обрабатывается одним набором параметров
+    void setInput(FrameRing *input) { this->input = input; }
+    void stop();
+
 
     // ====================================================================
     // Input
@@ -44,28 +84,58 @@ public:
         ProcessContour,
         ProcessHoughCircles
     };
-    void setMode(Mode mode) { this->mode = mode; }
-    Mode getMode() { return mode; }
+    void setMode(Mode mode);
+    Mode getMode();
 
-    void setImage(IplImage *image);
-    IplImage *getImage() { return image; }
+    // Кадр для обработки. Process держит ссылку на кадр,
+    // а не копию изображения
+    void setFrame(const Frame &frame);
+
+    // Регионы и последовательности последнего step(). Читать только
+    // из потока, который вызывает step(), например в замерах
+    const Areas &getAreas() { return areas; }
+    const SeqAreas &getSeqAreas() { return *seqAreasResult; }
 
     // ====================================================================
     // Output
     // ====================================================================
 
-    // Возвращает одноканальную картинку с отмеченными
-    // точками: 0 - не подходящий пиксель, 1 - подходящий
-    IplImage *getHitImage() { return hitImage; }
+    // Результат последнего обработанного кадра. Вызывать только из
+    // потока GUI: взятый результат не меняется до следующего takeResult()
+    const ProcessResult *takeResult() { return results.take(); }
+    const ProcessResult *getResult() { return results.getFront(); }
 
-    // Возвращает структуру с найдеными регионами
-    Areas &getAreas() { return areas; }
+    // Номер кадра последнего опубликованного результата
+    // (0 - результата еще нет)
+    unsigned int getResultNumber() { return resultNumber; }
 
-    // Возвращает структуру с последовательностью регионов
-    SeqAreas &getSeqAreas() { return *seqAreasResult; }
+    // Сколько кадров захвата пропущено, потому что обработка не успевала
+    unsigned int getSkipped() { return skipped; }
 
-    //
-    Contours &getContours() { return contours; }
+    // Получатель каждого опубликованного результата, вызывается
+    // в потоке обработки. Добавлять до start(), владеет вызывающий
+    void addSink(ResultSink *sink) { sinks.push_back(sink); }
+
+    // Сколько результатов опубликовано с запуска
+    unsigned int getProcessed() { return processed; }
+
+    // Время от захвата кадра до публикации его результата
+    StageTimer &getLatencyTimer() { return latencyTimer; }
+
+    // Детекторы цвета и движения пишут найденные точки
+    // в упакованную маску (по умолчанию) или в hitImage
+    void setPackedMask(bool packed);
+    bool isPackedMask();
+
+    // Копировать маску найденных точек в опубликованный результат.
+    // Нужна только окну отладки, поэтому по умолчанию выключено
+    void setPublishHitMask(bool publish);
+    bool isPublishHitMask();
+
+    // Сколько потоков, включая поток обработки, делят между собой
+    // строки кадра в попиксельных этапах (по умолчанию 1)
+    void setThreadCount(int threads);
+    int getThreadCount();
 
     // ====================================================================
     // Color Parameters
@@ -90,21 +160,46 @@ public:
         unsigned char Vmax;    // Максимум яркости
     };
 
-    void setColorRangeMode(ColorRangeMode mode) { colorRangeMode = mode; }
-    ColorRangeMode getColorRangeMode() { return colorRangeMode; }
+    void setColorRangeMode(ColorRangeMode mode);
+    ColorRangeMode getColorRangeMode();
 
-    void setColorRangeParam(ColorRangeParam param) { colorRangeParam = param; }
-    ColorRangeParam getColorRangeParam() { return colorRangeParam; }
+    void setColorRangeParam(ColorRangeParam param);
+    ColorRangeParam getColorRangeParam();
+
+    // Как проверяется условие цвета. ColorPathAuto: векторным ядром,
+    // если есть AVX2 (оно быстрее проверки бита в таблице), иначе по
+    // таблице ColorTable, как только она построена. Остальные - для замеров
+    enum ColorPath {
+        ColorPathAuto,
+        ColorPathTable,
+        ColorPathSimd
+    };
+    void setColorPath(ColorPath path);
+    ColorPath getColorPath();
+
+    // Дождаться построения таблицы цвета (для замеров без GUI)
+    void waitColorTable() { colorTable.wait(); }
+
+    // Последний step() режима Color проверял пиксели по таблице
+    bool isColorTableUsed() { return colorTableUsed; }
 
     // ====================================================================
     // Motion Parameters
     // ====================================================================
 
+    enum MotionMode {
+        MotionFrameDiff,    // Разность с предыдущим кадром
+        MotionBackground    // Разность с моделью фона
+    };
+
     struct MotionParam {
-        int sensitivity;
+        MotionMode mode;
+        int sensitivity;    // Минимальная сумма разностей каналов
+        int learnShift;     // Скорость обучения фона 1/2^learnShift, 1..8
     };
 
-    void setMotionParam(MotionParam param) { motionParam = param; }
+    void setMotionParam(MotionParam param);
+    MotionParam getMotionParam();
 
     // ====================================================================
     // Haar Parameters
@@ -118,7 +213,12 @@ public:
         int maxSizeY;
     };
 
+    // Каскад загружается в отдельном потоке, до окончания загрузки
+    // используется предыдущий
     void setHaarFile(string file);
+
+    // Дождаться окончания загрузки (для замеров без GUI)
+    void waitHaarFile() { haarLoader.wait(); }
     void setHaarParam(HaarParam param);
 
     // ====================================================================
@@ -145,7 +245,7 @@ public:
         int maxRadius;
     };
 
-    void setHoughCircleParam(HoughCirclesParam param) { houghCirclesParam = param; }
+    void setHoughCircleParam(HoughCirclesParam param);
 
     // ====================================================================
     // Sequences Parameters
@@ -180,13 +280,60 @@ public:
         double deepHs;
     };
 
-    void setTransform2DParam(Transform2DParam param) { trans2D = param; }
-    void transform2D(int px, int py, int &qx, int &qy);
+    void setTransform2DParam(Transform2DParam param);
+    Transform2DParam getTransform2DParam();
+
+    void transform2D(int px, int py, int &qx, int &qy) { transform2D(trans2D, px, py, qx, qy); }
     void transform2DContrary(int px, int py, int &qx, int &qy);
 
+    // Преобразование с заданными параметрами, для потока GUI
+    static void transform2D(const Transform2DParam &trans2D, int px, int py, int &qx, int &qy);
+
+    // ====================================================================
+    // Clustering Parameters
+    // ====================================================================
+
+    // Скрывают методы Clustering: параметры кластеризации
+    // тоже меняются только в начале кадра
+    void setClusterMode(ClusterMode mode);
+    void setSimpleClusterParam(SimpleClusterParam param);
+    void setTableClusterParam(TableClusterParam param);
+
 protected:
     void run();
 
+    // ====================================================================
+    // Параметры
+    // ====================================================================
+
+    // Все параметры обработки одним блоком
+    struct Param {
+        Mode mode;
+        bool packedMask;
+        bool publishHitMask;
+        int threads;
+        ColorRangeMode colorRangeMode;
+        ColorRangeParam colorRangeParam;
+        int colorGeneration;
+        ColorPath colorPath;
+        MotionParam motionParam;
+        HaarParam haarParam;
+        ContourParam contourParam;
+        HoughCirclesParam houghCirclesParam;
+        SeqAreaParam seqAreaParam;
+        FilterSeqAreaParam filterSeqAreaParam;
+        Transform2DParam trans2D;
+        ClusterMode clusterMode;
+        SimpleClusterParam simpleClusterParam;
+        TableClusterParam tableClusterParam;
+    };
+
+    // Что изменилось в pending с прошлого applyParam()
+    enum ParamChange {
+        ParamChanged        = 1,
+        ParamSeqAreaChanged = 2
+    };
+
     // ====================================================================
     // Вспомогательные функции
     // ====================================================================
@@ -196,6 +343,7 @@ protected:
 
     // Поиск последовательностей регионов
     void findSeqAreas(Areas &areas, SeqAreas &seqAreas);
+    static void copyMoments(SeqArea &seqArea, const Area &area);
 
     // Фильтр последовательностей регионов
     void filterSeqAreas(SeqAreas &seqAreas, SeqAreasBuffer &seqAreasBuffer);
@@ -204,14 +352,52 @@ private:
     int width;   // Ширина и высота изображений,
     int height;  // которые будут обрабатываться
 
-    int timeMean;
-    int timeNum;
+    QString name;
+
+    qint64 stageTime[StageCount];
+    qint64 stageStart;
+    StageTimer stageTimers[StageCount];
+    StageTimer latencyTimer;
+
+    // Закончить этап stage и начать отсчет следующего
+    void endStage(Stage stage);
+
+    // Параметры, записанные потоком GUI, но еще не примененные.
+    // Защищены paramMutex
+    QMutex paramMutex;
+    Param pending;
+    volatile int paramChanges;
+
+    HaarLoader haarLoader;
+
+    // Вызывается в начале step(): переносит pending в рабочие параметры
+    // и забирает загруженный каскад
+    void applyParam();
+
+    FrameRing *input;
+    volatile bool stopped;
+
+    // ====================================================================
+    // Опубликованный результат
+    // ====================================================================
+
+    ResultBuffer results;
+    volatile unsigned int resultNumber;
+    volatile unsigned int skipped;
+    volatile unsigned int processed;
+
+    vector<ResultSink *> sinks;
+
+    // Копирует результат кадра frame в свободный буфер результатов
+    // и публикует его
+    const ProcessResult *publish(const Frame &frame);
 
     // ====================================================================
     // Input
     // ====================================================================
 
     Mode mode;
+    Frame frame;
     IplImage *image;
 
     // ====================================================================
@@ -225,8 +411,30 @@ private:
 
     IplImage *hitImage;    // Одноканальное изображение с найденными пикселями
 
+    HitMask hitMask;       // То же самое, один бит на пиксель
+    bool packedMask;       // Писать найденные пиксели в hitMask
+    bool hitPacked;        // Результат последнего кадра находится в hitMask
+    bool publishHitMask;   // Копировать маску в ProcessResult
+
+    // Строки, которые затем упаковываются в hitMask, по одной
+    // на каждый поток pool
+    vector< vector<uchar> > hitRows;
+
+    // Строка, в которую детектор в потоке thread записывает найденные
+    // точки (0/255), и ее упаковка в hitMask после заполнения
+    uchar *beginHitRow(int y, int thread);
+    void endHitRow(int y, int thread);
+
+    // Потоки для попиксельных этапов. Методы *Rows обрабатывают
+    // полосу строк [begin, end) и вызываются через pool.parallelFor,
+    // параметры этапа они берут из полей rows*
+    ThreadPool pool;
+
+    // Кластеризация той маски, в которую писал детектор
+    void findHitClusters();
+
     IplImage *grayImage;
-    IplImage *prevImage;
+    Frame prevFrame;       // Предыдущий кадр для поиска движения
 
     // ====================================================================
     // Color
@@ -235,9 +443,25 @@ private:
     ColorRangeMode colorRangeMode;
     ColorRangeParam colorRangeParam;
 
+    // Битовая таблица условия по цвету и номер параметров,
+    // для которых она должна быть построена
+    ColorTable colorTable;
+    int colorGeneration;
+    ColorPath colorPath;
+    bool colorTableUsed;
+
+    // Запускает перестройку colorTable для pending.colorRangeParam.
+    // Вызывается под paramMutex
+    void updateColorTable();
+
     // Находит на изображении регионы с нужным цветовым диапазоном,
     void findColor();
 
+    const ColorTable::Table *rowsColorTable;
+    ProcessSimd::ColorRange rowsColorRange;
+    void findColorTableRows(int begin, int end, int thread);
+    void findColorRows(int begin, int end, int thread);
+
     // ====================================================================
     // Motion
     // ====================================================================
@@ -245,6 +469,21 @@ private:
     MotionParam motionParam;
     void findMotion();
 
+    // Разность текущего и предыдущего кадра
+    void findMotionDiff();
+
+    IplImage *rowsPrevImage;
+    void findMotionDiffRows(int begin, int end, int thread);
+
+    // Разность с моделью фона, модель обновляется за тот же проход.
+    // Медленно движущиеся объекты не пропадают, а мерцание освещения
+    // со временем перестает отмечаться
+    BackgroundModel background;
+    void findMotionBackground();
+
+    ProcessSimd::BackgroundParam rowsBackgroundParam;
+    void findMotionBackgroundRows(int begin, int end, int thread);
+
     // ====================================================================
     // Haar
     // ====================================================================
@@ -295,6 +534,7 @@ private:
     // ====================================================================
 
     Transform2DParam trans2D;
+    static void setRectMoments(Area &area);
     void transform2DArea(Area &area);
     void transform2DAreas(Areas &areas);
 
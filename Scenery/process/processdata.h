@@ -16,6 +16,17 @@ struct Area {
     int height;
     int widthReal;
     int heightReal;
+
+    // Геометрия по моментам точек региона (ClusterSimple).
+    // Для остальных алгоритмов центр масс совпадает с центром
+    // прямоугольника, а оси - с его сторонами. pixels для ClusterTable -
+    // число отмеченных точек в ячейке, для Haar и HoughCircles - 0
+    int pixels;             // Количество отмеченных точек
+    int centroid[2];
+    double centroidReal[2];
+    double orientation;     // Угол главной оси к оси X, радианы (-pi/2, pi/2]
+    double majorAxisReal;   // Длины осей эллипса с теми же
+    double minorAxisReal;   // вторыми моментами
 };
 
 struct SeqArea {
@@ -40,6 +51,14 @@ struct SeqArea {
     int widthReal;
     int heightReal;
 
+    // Моменты региона, см. Area
+    int pixels;
+    int centroid[2];
+    double centroidReal[2];
+    double orientation;
+    double majorAxisReal;
+    double minorAxisReal;
+
     double length;
     double angle;
 };
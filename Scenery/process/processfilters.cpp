@@ -9,6 +9,8 @@ ProcessFilters::ProcessFilters(int width, int height)
 
     gray = cvCreateImage( cvSize(width, height), IPL_DEPTH_8U, 1 );
     slit = cvCreateImage( cvSize(width, height), IPL_DEPTH_8U, 3 );
+
+    threadPool = 0;
 }
 
 ProcessFilters::~ProcessFilters()
@@ -17,6 +19,14 @@ ProcessFilters::~ProcessFilters()
     cvReleaseImage(&slit);
 }
 
+void ProcessFilters::parallelFor(int rows, RowMethod<ProcessFilters>::Method method)
+{
+    if (threadPool)
+        threadPool->parallelFor(rows, this, method);
+    else
+        (this->*method)(0, rows, 0);
+}
+
 void ProcessFilters::filterKuwahara(IplImage *image, IplImage *result, int kernel_size)
 {
     /*
@@ -50,18 +60,28 @@ printf("Std. deviation: %f\n", sqrt(m2-m1*m1));
 
 
 
-    //int nchannels= image->nChannels;
-    int w=image->width;
-    int h=image->height;
-
-    int dt=kernel_size/2;
-
     //TODO:  -  .
 
     cvCvtColor(image, gray, CV_RGB2GRAY);
 
+    rowsImage = image;
+    rowsResult = result;
+    rowsKernel = kernel_size;
+    parallelFor(image->height, &ProcessFilters::filterKuwaharaRows);
+}
+
+void ProcessFilters::filterKuwaharaRows(int begin, int end, int thread)
+{
+    Q_UNUSED(thread);
+
+    //int nchannels= image->nChannels;
+    int w=rowsImage->width;
+    int h=rowsImage->height;
+    IplImage *result = rowsResult;
 
-    for( int y=2*dt; y <h-2*dt ; ++y )
+    int dt=rowsKernel/2;
+
+    for( int y=qMax(begin, 2*dt); y <qMin(end, h-2*dt) ; ++y )
     {
             uchar* ptr = (uchar*) (gray->imageData + y*gray->widthStep);
             uchar* p_out = (uchar*) (result->imageData + y*result->widthStep);
@@ -199,10 +219,20 @@ printf("Std. deviation: %f\n", sqrt(m2-m1*m1));
 
 void ProcessFilters::slitImage(IplImage *image)
 {
+    rowsImage = image;
+    parallelFor(image->height, &ProcessFilters::slitImageRows);
+}
+
+void ProcessFilters::slitImageRows(int begin, int end, int thread)
+{
+    Q_UNUSED(thread);
+
+    IplImage *image = rowsImage;
+
     // for 3 channels
     int c = image->nChannels;
 
-    for( int y=0; y<image->height; y++ ) {
+    for( int y=begin; y<end; y++ ) {
 
         //      'y'
         uchar* img_ptr = (uchar*) (image->imageData + y * image->widthStep);
@@ -2,6 +2,7 @@
 #define PROCESSFILTERS_H
 
 #include "processtools.h"
+#include "threadpool.h"
 
 #include <opencv/cxcore.h>
 #include <opencv/cvaux.h>
@@ -12,6 +13,10 @@ public:
     ProcessFilters(int width, int height);
     ~ProcessFilters();
 
+    // ,     .
+    //       
+    void setThreadPool(ThreadPool *pool) { threadPool = pool; }
+
     void filterKuwahara(IplImage* image, IplImage *result, int kernel_size);
 
     void slitImage(IplImage* image);
@@ -25,6 +30,18 @@ private:
     IplImage *gray;
     IplImage *slit;
 
+    ThreadPool *threadPool;
+
+    //      *Rows
+    IplImage *rowsImage;
+    IplImage *rowsResult;
+    int rowsKernel;
+
+    void filterKuwaharaRows(int begin, int end, int thread);
+    void slitImageRows(int begin, int end, int thread);
+
+    void parallelFor(int rows, RowMethod<ProcessFilters>::Method method);
+
 };
 
 #endif // PROCESSFILTERS_H
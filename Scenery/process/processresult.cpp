@@ -0,0 +1,39 @@
+#include "processresult.h"
+
+ProcessResult::ProcessResult(int width, int height) :
+    hitMask(width, height)
+{
+    number = 0;
+    latency = 0;
+}
+
+ResultBuffer::ResultBuffer(int width, int height) :
+    middle(1)
+{
+    for ( int i=0; i<3; i++ ) {
+        results[i] = new ProcessResult(width, height);
+    }
+
+    front = 0;
+    back = 2;
+}
+
+ResultBuffer::~ResultBuffer()
+{
+    for ( int i=0; i<3; i++ ) {
+        delete results[i];
+    }
+}
+
+void ResultBuffer::publish()
+{
+    back = middle.fetchAndStoreOrdered(back | FRESH) & ~FRESH;
+}
+
+const ProcessResult *ResultBuffer::take()
+{
+    if ( middle.fetchAndAddOrdered(0) & FRESH )
+        front = middle.fetchAndStoreOrdered(front) & ~FRESH;
+
+    return results[front];
+}
@@ -0,0 +1,55 @@
+#ifndef PROCESSRESULT_H
+#define PROCESSRESULT_H
+
+#include <QAtomicInt>
+
+#include "framebuffer.h"
+#include "hitmask.h"
+#include "processdata.h"
+
+// Результат обработки одного кадра. После публикации
+// не меняется, пока читатель не возьмет следующий
+struct ProcessResult {
+    ProcessResult(int width, int height);
+
+    Frame frame;            // Кадр, по которому получен результат
+    unsigned int number;    // Номер кадра (0 - результата еще нет)
+    qint64 latency;         // От захвата до публикации, мкс
+
+    Areas areas;
+    SeqAreas seqAreas;
+    Contours contours;
+    HitMask hitMask;        // Только при Process::setPublishHitMask(true)
+};
+
+// Тройной буфер результатов между потоком обработки и потоком GUI.
+// Обработка заполняет свой результат и меняет его местом со средним
+// одной атомарной операцией, GUI так же забирает средний результат.
+// Никто никого не ждет, а взятый результат не меняется
+// до следующего take()
+class ResultBuffer
+{
+public:
+    ResultBuffer(int width, int height);
+    ~ResultBuffer();
+
+    // Обработка: результат для заполнения и его публикация
+    ProcessResult *getBack() { return results[back]; }
+    void publish();
+
+    // GUI: последний опубликованный результат. Если нового нет,
+    // возвращает взятый ранее
+    const ProcessResult *take();
+    const ProcessResult *getFront() { return results[front]; }
+
+private:
+    ProcessResult *results[3];
+
+    int back;           // Принадлежит обработке
+    int front;          // Принадлежит GUI
+    QAtomicInt middle;  // Индекс среднего результата и флаг FRESH
+
+    enum { FRESH = 4 };
+};
+
+#endif // PROCESSRESULT_H
@@ -0,0 +1,731 @@
+#include "processsimd.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PROCESS_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(PROCESS_SSE2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PROCESS_AVX2
+#include <immintrin.h>
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+ProcessSimd::Instructions ProcessSimd::current = ProcessSimd::supported();
+
+ProcessSimd::Instructions ProcessSimd::supported()
+{
+#if defined(PROCESS_AVX2)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return AVX2;
+#endif
+#if defined(PROCESS_SSE2)
+    return SSE2;
+#else
+    return Scalar;
+#endif
+}
+
+void ProcessSimd::setInstructions(Instructions instructions)
+{
+    Instructions best = supported();
+    current = instructions < best ? instructions : best;
+}
+
+// ====================================================================
+// Color
+// ====================================================================
+
+/*
+  Таблицы HTable/STable/VTable заменены прямым вычислением условия
+  в целых числах, без деления:
+
+  H = 255*h/360, где h - тон в градусах. Поэтому
+     H >= Hmin  <=>  h >= ceil(360*Hmin/255)       = hLo
+     H <= Hmax  <=>  h <  ceil(360*(Hmax+1)/255)   = hHi
+
+  Тон h = base + 60*num/delta, где base - начало сектора (0, 120, 240
+  или 360 для отрицательных num при максимуме в красном). Умножив на
+  delta, получаем сравнения вида 60*num >= (hLo - base)*delta.
+  Так как |60*num| <= 60*delta, разность (hLo - base) можно ограничить
+  [-61, 61] и считать все в 16 битах.
+
+  S = 255*delta/max, поэтому S >= Smin <=> 255*delta >= Smin*max
+*/
+
+ProcessSimd::ColorRange ProcessSimd::colorRange(bool invert,
+                                                unsigned char Hmin, unsigned char Hmax,
+                                                unsigned char Smin, unsigned char Vmin)
+{
+    ColorRange range;
+    range.hLo = (360*Hmin + 254) / 255;
+    range.hHi = (360*(Hmax + 1) + 254) / 255;
+    range.hZero = Hmin == 0;
+    range.invert = invert;
+    range.Smin = Smin;
+    range.Vmin = Vmin;
+    return range;
+}
+
+void ProcessSimd::findColor(const unsigned char *bgr, unsigned char *hit,
+                            int count, const ColorRange &range)
+{
+    switch (current) {
+    case AVX2:
+        findColorAVX2(bgr, hit, count, range);
+        break;
+    case SSE2:
+        findColorSSE2(bgr, hit, count, range);
+        break;
+    case Scalar:
+        findColorScalar(bgr, hit, count, range);
+        break;
+    }
+}
+
+void ProcessSimd::findColorScalar(const unsigned char *bgr, unsigned char *hit,
+                                  int count, const ColorRange &range)
+{
+    for (int x=0; x<count; x++) {
+        int b = bgr[3*x+0];
+        int g = bgr[3*x+1];
+        int r = bgr[3*x+2];
+
+        int max = r > g ? r : g;
+        max = max > b ? max : b;
+        int min = r < g ? r : g;
+        min = min < b ? min : b;
+        int delta = max - min;
+
+        bool h;
+        if (delta == 0) {
+            h = range.hZero;
+        }
+        else {
+            int num, base;
+            if (r == max) {
+                num = g - b;
+                base = num < 0 ? 360 : 0;
+            }
+            else if (g == max) {
+                num = b - r;
+                base = 120;
+            }
+            else {
+                num = r - g;
+                base = 240;
+            }
+
+            // Тон в градусах, умноженный на delta
+            int hd = 60*num + base*delta;
+            h = hd >= range.hLo*delta && hd < range.hHi*delta;
+        }
+
+        bool s = range.Smin == 0 || (delta > 0 && 255*delta >= range.Smin*max);
+        bool v = max >= range.Vmin;
+
+        hit[x] = ( (h ^ (range.invert != 0)) && s && v ) ? 255 : 0;
+    }
+}
+
+#if defined(PROCESS_SSE2)
+
+// Условие по H и S для 8 пикселей в 16-битном представлении
+static inline __m128i colorMask16(__m128i r, __m128i g, __m128i b,
+                                  __m128i max, __m128i delta,
+                                  const ProcessSimd::ColorRange &range)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_cmpeq_epi16(zero, zero);
+    const __m128i lim = _mm_set1_epi16(61);
+    const __m128i limNeg = _mm_set1_epi16(-61);
+
+    __m128i rMax = _mm_cmpeq_epi16(r, max);
+    __m128i gMax = _mm_andnot_si128(rMax, _mm_cmpeq_epi16(g, max));
+    __m128i bMax = _mm_andnot_si128(_mm_or_si128(rMax, gMax), ones);
+
+    __m128i num = _mm_or_si128(_mm_and_si128(rMax, _mm_sub_epi16(g, b)),
+                  _mm_or_si128(_mm_and_si128(gMax, _mm_sub_epi16(b, r)),
+                               _mm_and_si128(bMax, _mm_sub_epi16(r, g))));
+
+    __m128i neg = _mm_cmplt_epi16(num, zero);
+    __m128i base = _mm_or_si128(_mm_and_si128(_mm_and_si128(rMax, neg), _mm_set1_epi16(360)),
+                   _mm_or_si128(_mm_and_si128(gMax, _mm_set1_epi16(120)),
+                                _mm_and_si128(bMax, _mm_set1_epi16(240))));
+
+    __m128i lo = _mm_sub_epi16(_mm_set1_epi16(range.hLo), base);
+    __m128i hi = _mm_sub_epi16(_mm_set1_epi16(range.hHi), base);
+    lo = _mm_min_epi16(_mm_max_epi16(lo, limNeg), lim);
+    hi = _mm_min_epi16(_mm_max_epi16(hi, limNeg), lim);
+
+    __m128i num60 = _mm_mullo_epi16(num, _mm_set1_epi16(60));
+    __m128i h = _mm_andnot_si128(_mm_cmplt_epi16(num60, _mm_mullo_epi16(lo, delta)),
+                                 _mm_cmplt_epi16(num60, _mm_mullo_epi16(hi, delta)));
+
+    __m128i gray = _mm_cmpeq_epi16(delta, zero);
+    __m128i hZero = range.hZero ? ones : zero;
+    h = _mm_or_si128(_mm_and_si128(gray, hZero), _mm_andnot_si128(gray, h));
+    if (range.invert)
+        h = _mm_xor_si128(h, ones);
+
+    if (range.Smin > 0) {
+        // Smin*max <= 255*delta, оба произведения не больше 65025
+        __m128i sMax = _mm_mullo_epi16(_mm_set1_epi16(range.Smin), max);
+        __m128i sDelta = _mm_mullo_epi16(_mm_set1_epi16(255), delta);
+        __m128i s = _mm_cmpeq_epi16(_mm_subs_epu16(sMax, sDelta), zero);
+        h = _mm_and_si128(h, _mm_andnot_si128(gray, s));
+    }
+
+    return h;
+}
+
+void ProcessSimd::findColorSSE2(const unsigned char *bgr, unsigned char *hit,
+                                int count, const ColorRange &range)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i vMin = _mm_set1_epi8((char)range.Vmin);
+
+    unsigned char planes[3][16];
+
+    int x = 0;
+    for (; x + 16 <= count; x += 16) {
+        const unsigned char *p = bgr + 3*x;
+        for (int i=0; i<16; i++) {
+            planes[0][i] = p[3*i+0];
+            planes[1][i] = p[3*i+1];
+            planes[2][i] = p[3*i+2];
+        }
+
+        __m128i b = _mm_loadu_si128((const __m128i *)planes[0]);
+        __m128i g = _mm_loadu_si128((const __m128i *)planes[1]);
+        __m128i r = _mm_loadu_si128((const __m128i *)planes[2]);
+
+        __m128i max = _mm_max_epu8(_mm_max_epu8(r, g), b);
+        __m128i min = _mm_min_epu8(_mm_min_epu8(r, g), b);
+        __m128i delta = _mm_sub_epi8(max, min);
+
+        __m128i lo = colorMask16(_mm_unpacklo_epi8(r, zero), _mm_unpacklo_epi8(g, zero),
+                                 _mm_unpacklo_epi8(b, zero), _mm_unpacklo_epi8(max, zero),
+                                 _mm_unpacklo_epi8(delta, zero), range);
+        __m128i hi = colorMask16(_mm_unpackhi_epi8(r, zero), _mm_unpackhi_epi8(g, zero),
+                                 _mm_unpackhi_epi8(b, zero), _mm_unpackhi_epi8(max, zero),
+                                 _mm_unpackhi_epi8(delta, zero), range);
+
+        __m128i v = _mm_cmpeq_epi8(_mm_max_epu8(max, vMin), max);
+        __m128i result = _mm_and_si128(_mm_packs_epi16(lo, hi), v);
+
+        _mm_storeu_si128((__m128i *)(hit + x), result);
+    }
+
+    findColorScalar(bgr + 3*x, hit + x, count - x, range);
+}
+
+#else
+
+void ProcessSimd::findColorSSE2(const unsigned char *bgr, unsigned char *hit,
+                                int count, const ColorRange &range)
+{
+    findColorScalar(bgr, hit, count, range);
+}
+
+#endif
+
+#if defined(PROCESS_AVX2)
+
+TARGET_AVX2
+static inline __m256i colorMask16(__m256i r, __m256i g, __m256i b,
+                                  __m256i max, __m256i delta,
+                                  const ProcessSimd::ColorRange &range)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_cmpeq_epi16(zero, zero);
+    const __m256i lim = _mm256_set1_epi16(61);
+    const __m256i limNeg = _mm256_set1_epi16(-61);
+
+    __m256i rMax = _mm256_cmpeq_epi16(r, max);
+    __m256i gMax = _mm256_andnot_si256(rMax, _mm256_cmpeq_epi16(g, max));
+    __m256i bMax = _mm256_andnot_si256(_mm256_or_si256(rMax, gMax), ones);
+
+    __m256i num = _mm256_or_si256(_mm256_and_si256(rMax, _mm256_sub_epi16(g, b)),
+                  _mm256_or_si256(_mm256_and_si256(gMax, _mm256_sub_epi16(b, r)),
+                                  _mm256_and_si256(bMax, _mm256_sub_epi16(r, g))));
+
+    __m256i neg = _mm256_cmpgt_epi16(zero, num);
+    __m256i base = _mm256_or_si256(_mm256_and_si256(_mm256_and_si256(rMax, neg), _mm256_set1_epi16(360)),
+                   _mm256_or_si256(_mm256_and_si256(gMax, _mm256_set1_epi16(120)),
+                                   _mm256_and_si256(bMax, _mm256_set1_epi16(240))));
+
+    __m256i lo = _mm256_sub_epi16(_mm256_set1_epi16(range.hLo), base);
+    __m256i hi = _mm256_sub_epi16(_mm256_set1_epi16(range.hHi), base);
+    lo = _mm256_min_epi16(_mm256_max_epi16(lo, limNeg), lim);
+    hi = _mm256_min_epi16(_mm256_max_epi16(hi, limNeg), lim);
+
+    __m256i num60 = _mm256_mullo_epi16(num, _mm256_set1_epi16(60));
+    __m256i h = _mm256_andnot_si256(_mm256_cmpgt_epi16(_mm256_mullo_epi16(lo, delta), num60),
+                                    _mm256_cmpgt_epi16(_mm256_mullo_epi16(hi, delta), num60));
+
+    __m256i gray = _mm256_cmpeq_epi16(delta, zero);
+    __m256i hZero = range.hZero ? ones : zero;
+    h = _mm256_or_si256(_mm256_and_si256(gray, hZero), _mm256_andnot_si256(gray, h));
+    if (range.invert)
+        h = _mm256_xor_si256(h, ones);
+
+    if (range.Smin > 0) {
+        __m256i sMax = _mm256_mullo_epi16(_mm256_set1_epi16(range.Smin), max);
+        __m256i sDelta = _mm256_mullo_epi16(_mm256_set1_epi16(255), delta);
+        __m256i s = _mm256_cmpeq_epi16(_mm256_subs_epu16(sMax, sDelta), zero);
+        h = _mm256_and_si256(h, _mm256_andnot_si256(gray, s));
+    }
+
+    return h;
+}
+
+// Разделяет 16 пикселей BGR (48 байт) на три плоскости
+TARGET_AVX2
+static inline void splitBGR16(const unsigned char *p, __m128i &b, __m128i &g, __m128i &r)
+{
+    __m128i c0 = _mm_loadu_si128((const __m128i *)(p + 0));
+    __m128i c1 = _mm_loadu_si128((const __m128i *)(p + 16));
+    __m128i c2 = _mm_loadu_si128((const __m128i *)(p + 32));
+
+    b = _mm_or_si128(_mm_or_si128(
+        _mm_shuffle_epi8(c0, _mm_setr_epi8( 0, 3, 6, 9,12,15,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1)),
+        _mm_shuffle_epi8(c1, _mm_setr_epi8(-1,-1,-1,-1,-1,-1, 2, 5, 8,11,14,-1,-1,-1,-1,-1))),
+        _mm_shuffle_epi8(c2, _mm_setr_epi8(-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1, 1, 4, 7,10,13)));
+    g = _mm_or_si128(_mm_or_si128(
+        _mm_shuffle_epi8(c0, _mm_setr_epi8( 1, 4, 7,10,13,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1)),
+        _mm_shuffle_epi8(c1, _mm_setr_epi8(-1,-1,-1,-1,-1, 0, 3, 6, 9,12,15,-1,-1,-1,-1,-1))),
+        _mm_shuffle_epi8(c2, _mm_setr_epi8(-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1, 2, 5, 8,11,14)));
+    r = _mm_or_si128(_mm_or_si128(
+        _mm_shuffle_epi8(c0, _mm_setr_epi8( 2, 5, 8,11,14,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1)),
+        _mm_shuffle_epi8(c1, _mm_setr_epi8(-1,-1,-1,-1,-1, 1, 4, 7,10,13,-1,-1,-1,-1,-1,-1))),
+        _mm_shuffle_epi8(c2, _mm_setr_epi8(-1,-1,-1,-1,-1,-1,-1,-1,-1,-1, 0, 3, 6, 9,12,15)));
+}
+
+TARGET_AVX2
+void ProcessSimd::findColorAVX2(const unsigned char *bgr, unsigned char *hit,
+                                int count, const ColorRange &range)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i vMin = _mm256_set1_epi8((char)range.Vmin);
+
+    int x = 0;
+    for (; x + 32 <= count; x += 32) {
+        __m128i b0, g0, r0, b1, g1, r1;
+        splitBGR16(bgr + 3*x, b0, g0, r0);
+        splitBGR16(bgr + 3*x + 48, b1, g1, r1);
+
+        __m256i b = _mm256_inserti128_si256(_mm256_castsi128_si256(b0), b1, 1);
+        __m256i g = _mm256_inserti128_si256(_mm256_castsi128_si256(g0), g1, 1);
+        __m256i r = _mm256_inserti128_si256(_mm256_castsi128_si256(r0), r1, 1);
+
+        __m256i max = _mm256_max_epu8(_mm256_max_epu8(r, g), b);
+        __m256i min = _mm256_min_epu8(_mm256_min_epu8(r, g), b);
+        __m256i delta = _mm256_sub_epi8(max, min);
+
+        // unpack и packs работают внутри 128-битных половин,
+        // поэтому порядок пикселей после упаковки сохраняется
+        __m256i lo = colorMask16(_mm256_unpacklo_epi8(r, zero), _mm256_unpacklo_epi8(g, zero),
+                                 _mm256_unpacklo_epi8(b, zero), _mm256_unpacklo_epi8(max, zero),
+                                 _mm256_unpacklo_epi8(delta, zero), range);
+        __m256i hi = colorMask16(_mm256_unpackhi_epi8(r, zero), _mm256_unpackhi_epi8(g, zero),
+                                 _mm256_unpackhi_epi8(b, zero), _mm256_unpackhi_epi8(max, zero),
+                                 _mm256_unpackhi_epi8(delta, zero), range);
+
+        __m256i v = _mm256_cmpeq_epi8(_mm256_max_epu8(max, vMin), max);
+        __m256i result = _mm256_and_si256(_mm256_packs_epi16(lo, hi), v);
+
+        _mm256_storeu_si256((__m256i *)(hit + x), result);
+    }
+
+    findColorSSE2(bgr + 3*x, hit + x, count - x, range);
+}
+
+#else
+
+void ProcessSimd::findColorAVX2(const unsigned char *bgr, unsigned char *hit,
+                                int count, const ColorRange &range)
+{
+    findColorSSE2(bgr, hit, count, range);
+}
+
+#endif
+
+// ====================================================================
+// Motion
+// ====================================================================
+
+/*
+  Модуль разности не зависит от канала, поэтому он считается сразу
+  по 16 байтам BGR подряд, а на плоскости B, G, R разделяются уже
+  разности. Сумма трех каналов (не больше 765) считается в 16 битах.
+*/
+
+void ProcessSimd::findMotion(const unsigned char *bgr, const unsigned char *prev,
+                             unsigned char *hit, int count, int sensitivity)
+{
+    switch (current) {
+    case AVX2:
+        findMotionAVX2(bgr, prev, hit, count, sensitivity);
+        break;
+    case SSE2:
+        findMotionSSE2(bgr, prev, hit, count, sensitivity);
+        break;
+    case Scalar:
+        findMotionScalar(bgr, prev, hit, count, sensitivity);
+        break;
+    }
+}
+
+void ProcessSimd::findMotionScalar(const unsigned char *bgr, const unsigned char *prev,
+                                   unsigned char *hit, int count, int sensitivity)
+{
+    for (int x=0; x<count; x++) {
+        int db = abs(bgr[3*x+0] - prev[3*x+0]);
+        int dg = abs(bgr[3*x+1] - prev[3*x+1]);
+        int dr = abs(bgr[3*x+2] - prev[3*x+2]);
+
+        hit[x] = dr+dg+db > sensitivity ? 255 : 0;
+    }
+}
+
+#if defined(PROCESS_SSE2)
+
+static inline __m128i absDiff8(__m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+}
+
+// Разделяет 16 пикселей BGR из трех регистров на три плоскости
+// без pshufb: четыре раунда чередования половин регистров
+static inline void splitBGR16SSE2(__m128i c0, __m128i c1, __m128i c2,
+                                  __m128i &b, __m128i &g, __m128i &r)
+{
+    for (int i=0; i<4; i++) {
+        __m128i t0 = _mm_unpacklo_epi8(c0, _mm_unpackhi_epi64(c1, c1));
+        __m128i t1 = _mm_unpacklo_epi8(_mm_unpackhi_epi64(c0, c0), c2);
+        __m128i t2 = _mm_unpacklo_epi8(c1, _mm_unpackhi_epi64(c2, c2));
+        c0 = t0;
+        c1 = t1;
+        c2 = t2;
+    }
+    b = c0;
+    g = c1;
+    r = c2;
+}
+
+void ProcessSimd::findMotionSSE2(const unsigned char *bgr, const unsigned char *prev,
+                                 unsigned char *hit, int count, int sensitivity)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i limit = _mm_set1_epi16(sensitivity);
+
+    int x = 0;
+    for (; x + 16 <= count; x += 16) {
+        const __m128i *p = (const __m128i *)(bgr + 3*x);
+        const __m128i *q = (const __m128i *)(prev + 3*x);
+
+        __m128i b, g, r;
+        splitBGR16SSE2(absDiff8(_mm_loadu_si128(p + 0), _mm_loadu_si128(q + 0)),
+                       absDiff8(_mm_loadu_si128(p + 1), _mm_loadu_si128(q + 1)),
+                       absDiff8(_mm_loadu_si128(p + 2), _mm_loadu_si128(q + 2)),
+                       b, g, r);
+
+        __m128i lo = _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi8(b, zero),
+                                                 _mm_unpacklo_epi8(g, zero)),
+                                   _mm_unpacklo_epi8(r, zero));
+        __m128i hi = _mm_add_epi16(_mm_add_epi16(_mm_unpackhi_epi8(b, zero),
+                                                 _mm_unpackhi_epi8(g, zero)),
+                                   _mm_unpackhi_epi8(r, zero));
+
+        __m128i result = _mm_packs_epi16(_mm_cmpgt_epi16(lo, limit),
+                                         _mm_cmpgt_epi16(hi, limit));
+        _mm_storeu_si128((__m128i *)(hit + x), result);
+    }
+
+    findMotionScalar(bgr + 3*x, prev + 3*x, hit + x, count - x, sensitivity);
+}
+
+#else
+
+void ProcessSimd::findMotionSSE2(const unsigned char *bgr, const unsigned char *prev,
+                                 unsigned char *hit, int count, int sensitivity)
+{
+    findMotionScalar(bgr, prev, hit, count, sensitivity);
+}
+
+#endif
+
+#if defined(PROCESS_AVX2)
+
+TARGET_AVX2
+static inline __m256i absDiff8(__m256i a, __m256i b)
+{
+    return _mm256_or_si256(_mm256_subs_epu8(a, b), _mm256_subs_epu8(b, a));
+}
+
+TARGET_AVX2
+void ProcessSimd::findMotionAVX2(const unsigned char *bgr, const unsigned char *prev,
+                                 unsigned char *hit, int count, int sensitivity)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i limit = _mm256_set1_epi16(sensitivity);
+
+    // Разности считаются сразу по 96 байтам (32 пикселя)
+    unsigned char diff[96];
+
+    int x = 0;
+    for (; x + 32 <= count; x += 32) {
+        const __m256i *p = (const __m256i *)(bgr + 3*x);
+        const __m256i *q = (const __m256i *)(prev + 3*x);
+
+        for (int i=0; i<3; i++)
+            _mm256_storeu_si256((__m256i *)(diff + 32*i),
+                                absDiff8(_mm256_loadu_si256(p + i), _mm256_loadu_si256(q + i)));
+
+        __m128i b0, g0, r0, b1, g1, r1;
+        splitBGR16(diff, b0, g0, r0);
+        splitBGR16(diff + 48, b1, g1, r1);
+
+        __m256i b = _mm256_inserti128_si256(_mm256_castsi128_si256(b0), b1, 1);
+        __m256i g = _mm256_inserti128_si256(_mm256_castsi128_si256(g0), g1, 1);
+        __m256i r = _mm256_inserti128_si256(_mm256_castsi128_si256(r0), r1, 1);
+
+        // unpack и packs работают внутри 128-битных половин,
+        // поэтому порядок пикселей после упаковки сохраняется
+        __m256i lo = _mm256_add_epi16(_mm256_add_epi16(_mm256_unpacklo_epi8(b, zero),
+                                                       _mm256_unpacklo_epi8(g, zero)),
+                                      _mm256_unpacklo_epi8(r, zero));
+        __m256i hi = _mm256_add_epi16(_mm256_add_epi16(_mm256_unpackhi_epi8(b, zero),
+                                                       _mm256_unpackhi_epi8(g, zero)),
+                                      _mm256_unpackhi_epi8(r, zero));
+
+        __m256i result = _mm256_packs_epi16(_mm256_cmpgt_epi16(lo, limit),
+                                            _mm256_cmpgt_epi16(hi, limit));
+        _mm256_storeu_si256((__m256i *)(hit + x), result);
+    }
+
+    findMotionSSE2(bgr + 3*x, prev + 3*x, hit + x, count - x, sensitivity);
+}
+
+#else
+
+void ProcessSimd::findMotionAVX2(const unsigned char *bgr, const unsigned char *prev,
+                                 unsigned char *hit, int count, int sensitivity)
+{
+    findMotionSSE2(bgr, prev, hit, count, sensitivity);
+}
+
+#endif
+
+// ====================================================================
+// Background
+// ====================================================================
+
+/*
+  Среднее значение канала m хранится в формате 8.8 и сдвигается
+  к новому значению v на 1/2^shift разности:
+     m += (v*256 - m) >> shift    (если v*256 > m)
+     m -= (m - v*256) >> shift    (иначе)
+  Сдвиг разности по модулю дает одинаковое округление в обе стороны
+  и не выходит за 16 бит без знака.
+
+  Так же обновляется среднее отклонение суммы разностей каналов d
+  (не больше 765) в формате 12.4. Пиксель отмечается, если
+     d > sensitivity + 2*deviation
+  то есть мерцающие пиксели сами становятся менее чувствительными.
+*/
+
+void ProcessSimd::findBackground(const unsigned char *bgr, unsigned short *model, int step,
+                                 unsigned char *hit, int count, const BackgroundParam &param)
+{
+    switch (current) {
+    case AVX2:
+        findBackgroundAVX2(bgr, model, step, hit, count, param);
+        break;
+    case SSE2:
+        findBackgroundSSE2(bgr, model, step, hit, count, param);
+        break;
+    case Scalar:
+        findBackgroundScalar(bgr, model, step, hit, count, param);
+        break;
+    }
+}
+
+static inline int updateMean(int mean, int value, int shift)
+{
+    if (value > mean)
+        return mean + ((value - mean) >> shift);
+    return mean - ((mean - value) >> shift);
+}
+
+void ProcessSimd::findBackgroundScalar(const unsigned char *bgr, unsigned short *model, int step,
+                                       unsigned char *hit, int count, const BackgroundParam &param)
+{
+    unsigned short *deviation = model + PlaneDeviation*step;
+
+    for (int x=0; x<count; x++) {
+        int d = 0;
+        for (int c=0; c<3; c++) {
+            unsigned short *mean = model + c*step + x;
+            int v = bgr[3*x+c];
+            d += abs(v - ((*mean + 128) >> 8));
+            *mean = updateMean(*mean, v << 8, param.shift);
+        }
+
+        hit[x] = d > param.sensitivity + (deviation[x] >> 3) ? 255 : 0;
+        deviation[x] = updateMean(deviation[x], d << 4, param.shift);
+    }
+}
+
+#if defined(PROCESS_SSE2)
+
+// Разность и обновление одного канала для 8 пикселей
+static inline __m128i backgroundChannel(__m128i v, unsigned short *mean, __m128i shift)
+{
+    __m128i m = _mm_loadu_si128((const __m128i *)mean);
+    __m128i rounded = _mm_srli_epi16(_mm_add_epi16(m, _mm_set1_epi16(128)), 8);
+    __m128i d = _mm_or_si128(_mm_subs_epu16(v, rounded), _mm_subs_epu16(rounded, v));
+
+    __m128i v8 = _mm_slli_epi16(v, 8);
+    __m128i up = _mm_srl_epi16(_mm_subs_epu16(v8, m), shift);
+    __m128i down = _mm_srl_epi16(_mm_subs_epu16(m, v8), shift);
+    _mm_storeu_si128((__m128i *)mean, _mm_sub_epi16(_mm_add_epi16(m, up), down));
+
+    return d;
+}
+
+// Маска 8 пикселей (0xFFFF - отличается от фона) в 16 битах
+static inline __m128i backgroundMask16(__m128i b, __m128i g, __m128i r,
+                                       unsigned short *model, int step,
+                                       const ProcessSimd::BackgroundParam &param)
+{
+    __m128i shift = _mm_cvtsi32_si128(param.shift);
+
+    __m128i d = backgroundChannel(b, model + ProcessSimd::PlaneB*step, shift);
+    d = _mm_add_epi16(d, backgroundChannel(g, model + ProcessSimd::PlaneG*step, shift));
+    d = _mm_add_epi16(d, backgroundChannel(r, model + ProcessSimd::PlaneR*step, shift));
+
+    unsigned short *deviation = model + ProcessSimd::PlaneDeviation*step;
+    __m128i dev = _mm_loadu_si128((const __m128i *)deviation);
+
+    // Все величины меньше 32768, поэтому сравнение со знаком
+    __m128i limit = _mm_add_epi16(_mm_set1_epi16(param.sensitivity), _mm_srli_epi16(dev, 3));
+    __m128i mask = _mm_cmpgt_epi16(d, limit);
+
+    __m128i d4 = _mm_slli_epi16(d, 4);
+    __m128i up = _mm_srl_epi16(_mm_subs_epu16(d4, dev), shift);
+    __m128i down = _mm_srl_epi16(_mm_subs_epu16(dev, d4), shift);
+    _mm_storeu_si128((__m128i *)deviation, _mm_sub_epi16(_mm_add_epi16(dev, up), down));
+
+    return mask;
+}
+
+void ProcessSimd::findBackgroundSSE2(const unsigned char *bgr, unsigned short *model, int step,
+                                     unsigned char *hit, int count, const BackgroundParam &param)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    unsigned char planes[3][16];
+
+    int x = 0;
+    for (; x + 16 <= count; x += 16) {
+        const unsigned char *p = bgr + 3*x;
+        for (int i=0; i<16; i++) {
+            planes[0][i] = p[3*i+0];
+            planes[1][i] = p[3*i+1];
+            planes[2][i] = p[3*i+2];
+        }
+
+        __m128i b = _mm_loadu_si128((const __m128i *)planes[0]);
+        __m128i g = _mm_loadu_si128((const __m128i *)planes[1]);
+        __m128i r = _mm_loadu_si128((const __m128i *)planes[2]);
+
+        __m128i lo = backgroundMask16(_mm_unpacklo_epi8(b, zero), _mm_unpacklo_epi8(g, zero),
+                                      _mm_unpacklo_epi8(r, zero), model + x, step, param);
+        __m128i hi = backgroundMask16(_mm_unpackhi_epi8(b, zero), _mm_unpackhi_epi8(g, zero),
+                                      _mm_unpackhi_epi8(r, zero), model + x + 8, step, param);
+
+        _mm_storeu_si128((__m128i *)(hit + x), _mm_packs_epi16(lo, hi));
+    }
+
+    findBackgroundScalar(bgr + 3*x, model + x, step, hit + x, count - x, param);
+}
+
+#else
+
+void ProcessSimd::findBackgroundSSE2(const unsigned char *bgr, unsigned short *model, int step,
+                                     unsigned char *hit, int count, const BackgroundParam &param)
+{
+    findBackgroundScalar(bgr, model, step, hit, count, param);
+}
+
+#endif
+
+#if defined(PROCESS_AVX2)
+
+TARGET_AVX2
+static inline __m256i backgroundChannel(__m256i v, unsigned short *mean, __m128i shift)
+{
+    __m256i m = _mm256_loadu_si256((const __m256i *)mean);
+    __m256i rounded = _mm256_srli_epi16(_mm256_add_epi16(m, _mm256_set1_epi16(128)), 8);
+    __m256i d = _mm256_abs_epi16(_mm256_sub_epi16(v, rounded));
+
+    __m256i v8 = _mm256_slli_epi16(v, 8);
+    __m256i up = _mm256_srl_epi16(_mm256_subs_epu16(v8, m), shift);
+    __m256i down = _mm256_srl_epi16(_mm256_subs_epu16(m, v8), shift);
+    _mm256_storeu_si256((__m256i *)mean, _mm256_sub_epi16(_mm256_add_epi16(m, up), down));
+
+    return d;
+}
+
+TARGET_AVX2
+void ProcessSimd::findBackgroundAVX2(const unsigned char *bgr, unsigned short *model, int step,
+                                     unsigned char *hit, int count, const BackgroundParam &param)
+{
+    const __m128i shift = _mm_cvtsi32_si128(param.shift);
+    const __m256i sensitivity = _mm256_set1_epi16(param.sensitivity);
+
+    unsigned short *deviation = model + PlaneDeviation*step;
+
+    // 16 пикселей за шаг: каждый канал расширяется до 16 бит
+    // целиком в одном регистре, без перестановок между половинами
+    int x = 0;
+    for (; x + 16 <= count; x += 16) {
+        __m128i b, g, r;
+        splitBGR16(bgr + 3*x, b, g, r);
+
+        __m256i d = backgroundChannel(_mm256_cvtepu8_epi16(b), model + PlaneB*step + x, shift);
+        d = _mm256_add_epi16(d, backgroundChannel(_mm256_cvtepu8_epi16(g), model + PlaneG*step + x, shift));
+        d = _mm256_add_epi16(d, backgroundChannel(_mm256_cvtepu8_epi16(r), model + PlaneR*step + x, shift));
+
+        __m256i dev = _mm256_loadu_si256((const __m256i *)(deviation + x));
+        __m256i limit = _mm256_add_epi16(sensitivity, _mm256_srli_epi16(dev, 3));
+        __m256i mask = _mm256_cmpgt_epi16(d, limit);
+
+        __m256i d4 = _mm256_slli_epi16(d, 4);
+        __m256i up = _mm256_srl_epi16(_mm256_subs_epu16(d4, dev), shift);
+        __m256i down = _mm256_srl_epi16(_mm256_subs_epu16(dev, d4), shift);
+        _mm256_storeu_si256((__m256i *)(deviation + x), _mm256_sub_epi16(_mm256_add_epi16(dev, up), down));
+
+        __m128i result = _mm_packs_epi16(_mm256_castsi256_si128(mask),
+                                         _mm256_extracti128_si256(mask, 1));
+        _mm_storeu_si128((__m128i *)(hit + x), result);
+    }
+
+    findBackgroundSSE2(bgr + 3*x, model + x, step, hit + x, count - x, param);
+}
+
+#else
+
+void ProcessSimd::findBackgroundAVX2(const unsigned char *bgr, unsigned short *model, int step,
+                                     unsigned char *hit, int count, const BackgroundParam &param)
+{
+    findBackgroundSSE2(bgr, model, step, hit, count, param);
+}
+
+#endif
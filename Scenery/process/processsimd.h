@@ -0,0 +1,111 @@
+#ifndef PROCESSSIMD_H
+#define PROCESSSIMD_H
+
+// Векторные (SSE2/AVX2) версии попиксельных операций обработки.
+// Для каждой операции есть скалярный вариант, который дает
+// точно такой же результат и используется, если процессор
+// не поддерживает нужные инструкции.
+
+class ProcessSimd
+{
+public:
+    enum Instructions {
+        Scalar,
+        SSE2,
+        AVX2
+    };
+
+    // Лучший набор инструкций, доступный на этом процессоре
+    static Instructions supported();
+
+    // Набор инструкций, который используется сейчас.
+    // setInstructions() позволяет принудительно выбрать более
+    // простой вариант (для проверки и замеров)
+    static Instructions instructions() { return current; }
+    static void setInstructions(Instructions instructions);
+
+    // ====================================================================
+    // Color
+    // ====================================================================
+
+    // Диапазон цвета, заранее пересчитанный в целочисленные пороги.
+    // Условие то же, что и в Process::findColor:
+    // (Hmin <= H <= Hmax) ^ invert && S >= Smin && V >= Vmin
+    struct ColorRange {
+        short hLo;      // Минимальный тон в градусах (включительно)
+        short hHi;      // Максимальный тон в градусах (не включительно)
+        short hZero;    // Попадает ли в диапазон тон серых цветов (H = 0)
+        short invert;
+        short Smin;
+        short Vmin;
+    };
+
+    static ColorRange colorRange(bool invert,
+                                 unsigned char Hmin, unsigned char Hmax,
+                                 unsigned char Smin, unsigned char Vmin);
+
+    // Отмечает в hit (255 - подходит, 0 - нет) пиксели строки bgr
+    static void findColor(const unsigned char *bgr, unsigned char *hit,
+                          int count, const ColorRange &range);
+
+    // ====================================================================
+    // Motion
+    // ====================================================================
+
+    // Отмечает в hit пиксели, у которых сумма модулей разностей
+    // каналов bgr и prev больше sensitivity
+    static void findMotion(const unsigned char *bgr, const unsigned char *prev,
+                           unsigned char *hit, int count, int sensitivity);
+
+    // ====================================================================
+    // Background
+    // ====================================================================
+
+    // Модель фона строки - четыре плоскости по step значений:
+    // средние B, G, R в формате 8.8 и среднее отклонение суммы
+    // разностей каналов в формате 12.4 (см. BackgroundModel)
+    enum BackgroundPlane {
+        PlaneB,
+        PlaneG,
+        PlaneR,
+        PlaneDeviation,
+        PlaneCount
+    };
+
+    struct BackgroundParam {
+        short sensitivity;  // Минимальная сумма разностей каналов
+        short shift;        // Скорость обучения 1/2^shift, 1..8
+    };
+
+    // Отмечает в hit пиксели строки bgr, которые отличаются от фона
+    // больше, чем на sensitivity + 2 средних отклонения, и за тот же
+    // проход обновляет модель
+    static void findBackground(const unsigned char *bgr, unsigned short *model, int step,
+                               unsigned char *hit, int count, const BackgroundParam &param);
+
+private:
+    static Instructions current;
+
+    static void findColorScalar(const unsigned char *bgr, unsigned char *hit,
+                                int count, const ColorRange &range);
+    static void findColorSSE2(const unsigned char *bgr, unsigned char *hit,
+                              int count, const ColorRange &range);
+    static void findColorAVX2(const unsigned char *bgr, unsigned char *hit,
+                              int count, const ColorRange &range);
+
+    static void findMotionScalar(const unsigned char *bgr, const unsigned char *prev,
+                                 unsigned char *hit, int count, int sensitivity);
+    static void findMotionSSE2(const unsigned char *bgr, const unsigned char *prev,
+                               unsigned char *hit, int count, int sensitivity);
+    static void findMotionAVX2(const unsigned char *bgr, const unsigned char *prev,
+                               unsigned char *hit, int count, int sensitivity);
+
+    static void findBackgroundScalar(const unsigned char *bgr, unsigned short *model, int step,
+                                     unsigned char *hit, int count, const BackgroundParam &param);
+    static void findBackgroundSSE2(const unsigned char *bgr, unsigned short *model, int step,
+                                   unsigned char *hit, int count, const BackgroundParam &param);
+    static void findBackgroundAVX2(const unsigned char *bgr, unsigned short *model, int step,
+                                   unsigned char *hit, int count, const BackgroundParam &param);
+};
+
+#endif // PROCESSSIMD_H
@@ -1,10 +1,49 @@
 #include "processtools.h"
 #include <math.h>
+#include <string.h>
+
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryFile>
+#include <QThread>
+#include <QVector>
+#include <QDebug>
+
+// Размер одной таблицы
+#define RGB2HSV_SIZE (256*256*256+256*256+256)
+
+// Версия файла с таблицами. Нужно увеличивать при любом
+// изменении RGB2HSVi, иначе будут использованы старые таблицы
+#define RGB2HSV_CACHE_VERSION 1
+
+struct RGB2HSVHeader {
+    char magic[8];
+    unsigned int version;
+    unsigned int size;
+};
+
+static const char RGB2HSV_MAGIC[8] = "RGB2HSV";
 
 unsigned char *ProcessTools::HTable = 0;
 unsigned char *ProcessTools::STable = 0;
 unsigned char *ProcessTools::VTable = 0;
 
+QFile *ProcessTools::cache = 0;
+
+// Поток, заполняющий таблицы для части значений r
+class RGB2HSVThread : public QThread
+{
+public:
+    RGB2HSVThread(int rBegin, int rEnd) { this->rBegin = rBegin; this->rEnd = rEnd; }
+
+protected:
+    void run() { ProcessTools::fillRGB2HSV(rBegin, rEnd); }
+
+private:
+    int rBegin;
+    int rEnd;
+};
+
 ProcessTools::ProcessTools()
 {
 }
@@ -50,13 +89,39 @@ unsigned char ProcessTools::rgb2gray(unsigned char &r, unsigned char &g, unsigne
     return (unsigned char) ( (double)(r)*0.30 + (double)(g)*0.59 + (double)(b)*0.11 );
 }
 
-void ProcessTools::initRGB2HSV()
+void ProcessTools::initRGB2HSV(QString cacheFile)
 {
-    HTable = new unsigned char[256*256*256+256*256+256];
-    STable = new unsigned char[256*256*256+256*256+256];
-    VTable = new unsigned char[256*256*256+256*256+256];
+    if (HTable)
+        return;
+
+    if ( !cacheFile.isEmpty() && loadRGB2HSV(cacheFile) )
+        return;
 
-    for (int r=0; r<=255; r++)
+    HTable = new unsigned char[3*RGB2HSV_SIZE];
+    STable = HTable + RGB2HSV_SIZE;
+    VTable = STable + RGB2HSV_SIZE;
+
+    // Делим значения r между потоками поровну
+    int threadCount = qBound(1, QThread::idealThreadCount(), 256);
+    QVector<RGB2HSVThread *> threads;
+    for (int i=0; i<threadCount; i++) {
+        RGB2HSVThread *thread = new RGB2HSVThread(256*i/threadCount, 256*(i+1)/threadCount);
+        thread->start();
+        threads.append(thread);
+    }
+
+    for (int i=0; i<threads.size(); i++) {
+        threads[i]->wait();
+        delete threads[i];
+    }
+
+    if ( !cacheFile.isEmpty() )
+        saveRGB2HSV(cacheFile);
+}
+
+void ProcessTools::fillRGB2HSV(int rBegin, int rEnd)
+{
+    for (int r=rBegin; r<rEnd; r++)
         for(int g=0; g<=255; g++)
             for(int b=0; b<=255; b++)
             {
@@ -69,6 +134,90 @@ void ProcessTools::initRGB2HSV()
             }
 }
 
+bool ProcessTools::loadRGB2HSV(QString cacheFile)
+{
+    QFile *file = new QFile(cacheFile);
+    qint64 size = sizeof(RGB2HSVHeader) + 3*(qint64)RGB2HSV_SIZE;
+
+    if ( !file->open(QIODevice::ReadOnly) || file->size() != size ) {
+        delete file;
+        return false;
+    }
+
+    // Отображение только для чтения: страницы общие для всех программ,
+    // использующих этот файл
+    uchar *data = file->map(0, size);
+    if (!data) {
+        delete file;
+        return false;
+    }
+
+    RGB2HSVHeader *header = (RGB2HSVHeader *)data;
+    if ( memcmp(header->magic, RGB2HSV_MAGIC, sizeof(header->magic)) != 0 ||
+         header->version != RGB2HSV_CACHE_VERSION ||
+         header->size != RGB2HSV_SIZE )
+    {
+        qDebug() << "RGB2HSV cache is outdated:" << cacheFile;
+        delete file;
+        return false;
+    }
+
+    cache = file;
+    HTable = data + sizeof(RGB2HSVHeader);
+    STable = HTable + RGB2HSV_SIZE;
+    VTable = STable + RGB2HSV_SIZE;
+
+    qDebug() << "RGB2HSV cache mapped:" << cacheFile;
+    return true;
+}
+
+void ProcessTools::saveRGB2HSV(QString cacheFile)
+{
+    // Пишем во временный файл рядом с кэшем и переименовываем, чтобы
+    // другая запущенная программа не увидела недописанный файл. Имя
+    // уникальное: кэш могут сохранять сразу несколько программ
+    QFileInfo info(cacheFile);
+    QTemporaryFile file(info.absolutePath() + "/" + info.fileName() + ".XXXXXX");
+    if ( !file.open() ) {
+        qDebug() << "Error write RGB2HSV cache:" << cacheFile;
+        return;
+    }
+
+    // Файл удаляется или переименовывается явно ниже
+    file.setAutoRemove(false);
+    QString tempFile = file.fileName();
+
+    RGB2HSVHeader header;
+    memcpy(header.magic, RGB2HSV_MAGIC, sizeof(header.magic));
+    header.version = RGB2HSV_CACHE_VERSION;
+    header.size = RGB2HSV_SIZE;
+
+    bool ok = file.write((const char *)&header, sizeof(header)) == sizeof(header) &&
+              file.write((const char *)HTable, 3*(qint64)RGB2HSV_SIZE) == 3*(qint64)RGB2HSV_SIZE;
+    file.close();
+
+    if (!ok) {
+        qDebug() << "Error write RGB2HSV cache:" << cacheFile;
+        QFile::remove(tempFile);
+        return;
+    }
+
+    // rename() не заменяет существующий файл. Старый кэш может быть
+    // отображен в память другой программой, и в Windows его тогда
+    // нельзя удалить: остается старый кэш, а новый файл удаляется
+    if ( QFile::rename(tempFile, cacheFile) )
+        return;
+
+    if ( !QFile::remove(cacheFile) )
+        qDebug() << "RGB2HSV cache is in use, keeping the existing one:" << cacheFile;
+    else if ( QFile::rename(tempFile, cacheFile) )
+        return;
+    else
+        qDebug() << "Error write RGB2HSV cache:" << cacheFile;
+
+    QFile::remove(tempFile);
+}
+
 void ProcessTools::RGB2HSV(unsigned char *h, unsigned char *s, unsigned char *v,
                            unsigned char r, unsigned char g, unsigned char b)
 {
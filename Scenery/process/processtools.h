@@ -1,6 +1,10 @@
 #ifndef PROCESSTOOLS_H
 #define PROCESSTOOLS_H
 
+#include <QString>
+
+class QFile;
+
 class ProcessTools
 {
 public:
@@ -15,12 +19,24 @@ public:
     static unsigned char *STable;
     static unsigned char *VTable;
 
-    static void initRGB2HSV();
+    // Строит таблицы HTable/STable/VTable на всех ядрах. Если указан
+    // cacheFile, таблицы отображаются из этого файла только для чтения
+    // (несколько запущенных программ используют одни и те же страницы
+    // памяти), а при его отсутствии - сохраняются в него
+    static void initRGB2HSV(QString cacheFile = QString());
 
     static void RGB2HSV(unsigned char *h, unsigned char *s, unsigned char *v,
                  unsigned char r, unsigned char g, unsigned char b);
 
 private:
+    friend class RGB2HSVThread;
+
+    static QFile *cache;
+
+    static void fillRGB2HSV(int rBegin, int rEnd);
+    static bool loadRGB2HSV(QString cacheFile);
+    static void saveRGB2HSV(QString cacheFile);
+
     static void RGB2HSVi(int &h, int &s, int &v,
                   int  r, int  g, int  b);
 
@@ -0,0 +1,17 @@
+#ifndef RESULTSINK_H
+#define RESULTSINK_H
+
+#include "processresult.h"
+
+// Получатель результатов обработки вне сцены: файл, другой процесс,
+// сеть. Вызывается потоком обработки сразу после публикации каждого
+// результата, поэтому write() не должен надолго блокироваться
+class ResultSink
+{
+public:
+    virtual ~ResultSink() {}
+
+    virtual void write(const ProcessResult &result) = 0;
+};
+
+#endif // RESULTSINK_H
@@ -0,0 +1,177 @@
+#include "sharedsink.h"
+
+#include <QAtomicInt>
+#include <QDebug>
+
+#include <string.h>
+
+SharedSink::SharedSink(QString key, int slotCount, int slotSize)
+{
+    header = 0;
+    next = 0;
+
+    Q_ASSERT(slotCount > 0 && slotSize > (int)(sizeof(TrackSlotHeader) + sizeof(TrackFrame)));
+
+    int size = sizeof(TrackRingHeader) + slotCount * slotSize;
+
+    memory.setNativeKey(key);
+    if ( !memory.create(size) ) {
+        // Сегмент остался от прошлого запуска или его создал читатель
+        if ( memory.error() != QSharedMemory::AlreadyExists || !memory.attach() ) {
+            qDebug() << "Error create shared memory:" << key << memory.errorString();
+            return;
+        }
+        if ( memory.size() < size ) {
+            qDebug() << "Error shared memory size:" << key << memory.size();
+            memory.detach();
+            return;
+        }
+    }
+
+    memset(memory.data(), 0, size);
+
+    header = (TrackRingHeader *)memory.data();
+    header->slotCount = slotCount;
+    header->slotSize = slotSize;
+    header->version = TRACK_VERSION;
+    header->latest = 0;
+    header->frames = 0;
+
+    // magic последним: читатель проверяет его перед остальными полями
+    ((QAtomicInt *)&header->magic)->fetchAndStoreOrdered(TRACK_MAGIC);
+
+    qDebug() << "Shared memory:" << key << size;
+}
+
+SharedSink::~SharedSink()
+{
+    if (header)
+        memory.detach();
+}
+
+TrackSlotHeader *SharedSink::slot(unsigned int n)
+{
+    char *slots = (char *)memory.data() + sizeof(TrackRingHeader);
+    return (TrackSlotHeader *)(slots + n * header->slotSize);
+}
+
+void SharedSink::write(const ProcessResult &result)
+{
+    if (!header)
+        return;
+
+    TrackSlotHeader *current = slot(next);
+    QAtomicInt *sequence = (QAtomicInt *)&current->sequence;
+
+    // Нечетный sequence: читатель, попавший на этот слот, повторит чтение
+    sequence->fetchAndAddOrdered(1);
+
+    char *data = (char *)current + sizeof(TrackSlotHeader);
+    current->size = fill(data, header->slotSize - sizeof(TrackSlotHeader), result);
+
+    sequence->fetchAndAddOrdered(1);
+
+    ((QAtomicInt *)&header->latest)->fetchAndStoreOrdered(next);
+    ((QAtomicInt *)&header->frames)->fetchAndAddOrdered(1);
+
+    next = (next + 1) % header->slotCount;
+}
+
+unsigned int SharedSink::fill(char *data, unsigned int capacity, const ProcessResult &result)
+{
+    TrackFrame *frame = (TrackFrame *)data;
+    unsigned int size = sizeof(TrackFrame);
+
+    frame->number = result.number;
+    frame->latency = (unsigned int)result.latency;
+    frame->width = result.frame.isNull() ? 0 : result.frame.getImage()->width;
+    frame->height = result.frame.isNull() ? 0 : result.frame.getImage()->height;
+    frame->areaCount = 0;
+    frame->seqAreaCount = 0;
+    frame->contourCount = 0;
+    frame->contourPointCount = 0;
+    frame->truncated = 0;
+
+    // Регионы
+    for ( unsigned int i=0; i<result.areas.size(); i++ ) {
+        if ( size + sizeof(TrackArea) > capacity ) {
+            frame->truncated = 1;
+            break;
+        }
+        const Area &area = result.areas[i];
+        TrackArea *track = (TrackArea *)(data + size);
+        track->x = area.pt[0];
+        track->y = area.pt[1];
+        track->width = area.width;
+        track->height = area.height;
+        track->moments.pixels = area.pixels;
+        track->moments.centroidX = area.centroid[0];
+        track->moments.centroidY = area.centroid[1];
+        track->moments.orientation = area.orientation;
+        track->moments.majorAxis = area.majorAxisReal;
+        track->moments.minorAxis = area.minorAxisReal;
+        size += sizeof(TrackArea);
+        frame->areaCount++;
+    }
+
+    // Последовательности, только найденные
+    for ( unsigned int i=0; i<result.seqAreas.size(); i++ ) {
+        const SeqArea &seqArea = result.seqAreas[i];
+        if ( !seqArea.number )
+            continue;
+
+        if ( size + sizeof(TrackSeqArea) > capacity ) {
+            frame->truncated = 1;
+            break;
+        }
+        TrackSeqArea *track = (TrackSeqArea *)(data + size);
+        track->number = seqArea.number;
+        track->x = seqArea.pt[0];
+        track->y = seqArea.pt[1];
+        track->prevX = seqArea.ptPrev[0];
+        track->prevY = seqArea.ptPrev[1];
+        track->width = seqArea.width;
+        track->height = seqArea.height;
+        track->moments.pixels = seqArea.pixels;
+        track->moments.centroidX = seqArea.centroid[0];
+        track->moments.centroidY = seqArea.centroid[1];
+        track->moments.orientation = seqArea.orientation;
+        track->moments.majorAxis = seqArea.majorAxisReal;
+        track->moments.minorAxis = seqArea.minorAxisReal;
+        size += sizeof(TrackSeqArea);
+        frame->seqAreaCount++;
+    }
+
+    // Контуры: сначала столько контуров, сколько помещается целиком
+    unsigned int contourCount = 0;
+    unsigned int pointCount = 0;
+    unsigned int contourSize = 0;
+    for ( unsigned int i=0; i<result.contours.size(); i++ ) {
+        unsigned int points = result.contours[i].size();
+        unsigned int need = sizeof(int) + points * sizeof(TrackPoint);
+        if ( size + contourSize + need > capacity ) {
+            frame->truncated = 1;
+            break;
+        }
+        contourSize += need;
+        contourCount++;
+        pointCount += points;
+    }
+
+    int *counts = (int *)(data + size);
+    TrackPoint *points = (TrackPoint *)(data + size + contourCount * sizeof(int));
+    for ( unsigned int i=0; i<contourCount; i++ ) {
+        const Contour &contour = result.contours[i];
+        counts[i] = contour.size();
+        for ( unsigned int j=0; j<contour.size(); j++ ) {
+            points->x = contour[j].x;
+            points->y = contour[j].y;
+            points++;
+        }
+    }
+    frame->contourCount = contourCount;
+    frame->contourPointCount = pointCount;
+    size += contourSize;
+
+    return size;
+}
@@ -0,0 +1,40 @@
+#ifndef SHAREDSINK_H
+#define SHAREDSINK_H
+
+#include <QSharedMemory>
+
+#include "resultsink.h"
+#include "trackformat.h"
+
+// Количество и размер слотов кольца по умолчанию
+#define TRACK_SLOTS     4
+#define TRACK_SLOT_SIZE (256*1024)
+
+// Пишет треки, регионы и контуры каждого кадра в кольцо в разделяемой
+// памяти (формат в trackformat.h). Писатель никого не ждет: читатель,
+// который не успел, повторяет чтение последнего слота.
+//
+// key - собственный ключ ОС (QSharedMemory::setNativeKey): имя объекта
+// отображения в Windows, путь для ftok(key, 'Q') в Unix
+class SharedSink : public ResultSink
+{
+public:
+    SharedSink(QString key, int slotCount = TRACK_SLOTS, int slotSize = TRACK_SLOT_SIZE);
+    ~SharedSink();
+
+    bool isOpen() { return header != 0; }
+
+    void write(const ProcessResult &result);
+
+private:
+    QSharedMemory memory;
+    TrackRingHeader *header;
+    unsigned int next;      // Слот для следующего кадра
+
+    TrackSlotHeader *slot(unsigned int n);
+
+    // Записывает кадр в data, не больше capacity байт. Возвращает размер
+    static unsigned int fill(char *data, unsigned int capacity, const ProcessResult &result);
+};
+
+#endif // SHAREDSINK_H
@@ -0,0 +1,131 @@
+#include "stagetimer.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <QMutexLocker>
+
+#include <algorithm>
+
+QMutex StageTimer::timersMutex;
+QList<StageTimer *> StageTimer::timers;
+
+StageTimer::StageTimer(QString name)
+{
+    this->name = name;
+    samples.resize(STAGE_TIMER_SAMPLES);
+    next = 0;
+    count = 0;
+
+    QMutexLocker locker(&timersMutex);
+    timers.append(this);
+}
+
+StageTimer::~StageTimer()
+{
+    QMutexLocker locker(&timersMutex);
+    timers.removeOne(this);
+}
+
+void StageTimer::setName(QString name)
+{
+    QMutexLocker locker(&mutex);
+    this->name = name;
+}
+
+QString StageTimer::getName()
+{
+    QMutexLocker locker(&mutex);
+    return name;
+}
+
+void StageTimer::add(qint64 time)
+{
+    QMutexLocker locker(&mutex);
+
+    samples[next] = time;
+    next = (next + 1) % STAGE_TIMER_SAMPLES;
+    if ( count < STAGE_TIMER_SAMPLES )
+        count++;
+}
+
+StageTimer::Stats StageTimer::getStats()
+{
+    QVector<qint64> sorted;
+    {
+        QMutexLocker locker(&mutex);
+        sorted = samples.mid(0, count);
+    }
+    std::sort(sorted.begin(), sorted.end());
+
+    Stats stats;
+    stats.count = sorted.size();
+    stats.p50 = stats.p95 = stats.p99 = stats.max = 0;
+
+    if ( sorted.isEmpty() )
+        return stats;
+
+    // Ближайший ранг: наименьший замер, которого не превышают p% замеров
+    int n = sorted.size();
+    stats.p50 = sorted[(n * 50 + 99) / 100 - 1];
+    stats.p95 = sorted[(n * 95 + 99) / 100 - 1];
+    stats.p99 = sorted[(n * 99 + 99) / 100 - 1];
+    stats.max = sorted[n - 1];
+    return stats;
+}
+
+QList<StageTimer *> StageTimer::getTimers()
+{
+    QMutexLocker locker(&timersMutex);
+    return timers;
+}
+
+bool StageTimer::saveCsv(QString file)
+{
+    QFile csv(file);
+    if ( !csv.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text) )
+        return false;
+
+    QTextStream out(&csv);
+    out << "stage,count,p50,p95,p99,max\n";
+
+    QMutexLocker locker(&timersMutex);
+    for ( int i=0; i<timers.size(); i++ ) {
+        Stats stats = timers[i]->getStats();
+        out << timers[i]->getName() << ","
+            << stats.count << ","
+            << stats.p50 << ","
+            << stats.p95 << ","
+            << stats.p99 << ","
+            << stats.max << "\n";
+    }
+
+    return true;
+}
+
+bool StageTimer::saveJson(QString file)
+{
+    QFile json(file);
+    if ( !json.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text) )
+        return false;
+
+    QTextStream out(&json);
+    out << "{\n"
+        << "  \"units\": \"us\",\n"
+        << "  \"stages\": [\n";
+
+    QMutexLocker locker(&timersMutex);
+    for ( int i=0; i<timers.size(); i++ ) {
+        Stats stats = timers[i]->getStats();
+        out << "    {\"name\": \"" << timers[i]->getName() << "\", "
+            << "\"count\": " << stats.count << ", "
+            << "\"p50\": " << stats.p50 << ", "
+            << "\"p95\": " << stats.p95 << ", "
+            << "\"p99\": " << stats.p99 << ", "
+            << "\"max\": " << stats.max << "}"
+            << (i < timers.size() - 1 ? ",\n" : "\n");
+    }
+
+    out << "  ]\n"
+        << "}\n";
+    return true;
+}
@@ -0,0 +1,56 @@
+#ifndef STAGETIMER_H
+#define STAGETIMER_H
+
+#include <QString>
+#include <QMutex>
+#include <QVector>
+#include <QList>
+
+// Сколько последних замеров хранит каждый таймер
+#define STAGE_TIMER_SAMPLES 512
+
+// Таймер одного этапа конвейера: хранит длительности последних
+// STAGE_TIMER_SAMPLES кадров и считает по ним перцентили.
+// Все таймеры регистрируются в общем списке, чтобы их можно было
+// показать в окне и сохранить в файл, не зная, кому они принадлежат
+class StageTimer
+{
+public:
+    explicit StageTimer(QString name = QString());
+    ~StageTimer();
+
+    void setName(QString name);
+    QString getName();
+
+    // Добавить замер, мкс. Вызывается из потока этапа
+    void add(qint64 time);
+
+    struct Stats {
+        int count;      // Замеров в окне
+        qint64 p50;
+        qint64 p95;
+        qint64 p99;
+        qint64 max;
+    };
+
+    Stats getStats();
+
+    static QList<StageTimer *> getTimers();
+
+    // Сохранить перцентили всех таймеров
+    static bool saveCsv(QString file);
+    static bool saveJson(QString file);
+
+private:
+    QString name;
+
+    QMutex mutex;
+    QVector<qint64> samples;
+    int next;
+    int count;
+
+    static QMutex timersMutex;
+    static QList<StageTimer *> timers;
+};
+
+#endif // STAGETIMER_H
@@ -0,0 +1,160 @@
+#include "synthetic.h"
+
+#include <QtGlobal>
+
+#include <math.h>
+
+#define NOISE_TABLE_SIZE 65536
+
+SyntheticScene::SyntheticScene(int width, int height)
+{
+    this->width = width;
+    this->height = height;
+    setParam(defaultParam());
+}
+
+SyntheticScene::Param SyntheticScene::defaultParam()
+{
+    Param param;
+    param.blobs = 4;
+    param.radius = 20;
+    param.speed = 4;
+    param.noise = 10;
+    param.occlusion = 0;
+    param.seed = 1;
+    return param;
+}
+
+void SyntheticScene::setParam(Param param)
+{
+    if ( param.blobs < 0 ) param.blobs = 0;
+    if ( param.radius < 1 ) param.radius = 1;
+    if ( param.noise < 0 ) param.noise = 0;
+    if ( param.noise > 127 ) param.noise = 127;
+    if ( param.occlusion < 0 ) param.occlusion = 0;
+    if ( param.occlusion > 1 ) param.occlusion = 1;
+
+    this->param = param;
+    random = param.seed ? param.seed : 1;
+
+    // Цвета из диапазона поиска по умолчанию (красный - желтый)
+    static const CvScalar palette[] = {
+        CV_RGB(220, 30, 30),
+        CV_RGB(230, 120, 20),
+        CV_RGB(220, 200, 30),
+        CV_RGB(200, 60, 90)
+    };
+    int paletteSize = sizeof(palette) / sizeof(palette[0]);
+
+    blobs.resize(param.blobs);
+    colors.resize(param.blobs);
+    for ( int i=0; i<param.blobs; i++ ) {
+        Blob &blob = blobs[i];
+        blob.id = i + 1;
+        blob.x = param.radius + nextDouble() * qMax(width - 2*param.radius, 1);
+        blob.y = param.radius + nextDouble() * qMax(height - 2*param.radius, 1);
+
+        double angle = nextDouble() * 2 * M_PI;
+        blob.vx = cos(angle) * param.speed;
+        blob.vy = sin(angle) * param.speed;
+        blob.visible = true;
+
+        colors[i] = palette[i % paletteSize];
+    }
+
+    occluderX = 0;
+    occluderSpeed = param.speed;
+
+    noiseTable.resize(NOISE_TABLE_SIZE);
+    for ( int i=0; i<NOISE_TABLE_SIZE; i++ )
+        noiseTable[i] = param.noise ? (int)(nextRandom() % (2*param.noise + 1)) - param.noise : 0;
+
+    // Первый render() покажет начальные положения
+    for ( int i=0; i<param.blobs; i++ ) {
+        blobs[i].x -= blobs[i].vx;
+        blobs[i].y -= blobs[i].vy;
+    }
+    occluderX -= occluderSpeed;
+}
+
+void SyntheticScene::render(IplImage *image)
+{
+    Q_ASSERT(image->width == width && image->height == height && image->nChannels == 3);
+
+    move();
+
+    cvSet(image, cvScalarAll(40));
+
+    for ( unsigned int i=0; i<blobs.size(); i++ ) {
+        cvCircle(image, cvPoint((int)blobs[i].x, (int)blobs[i].y),
+                 param.radius, colors[i], CV_FILLED);
+    }
+
+    // Заслонка рисуется поверх кругов
+    int occluderWidth = (int)(param.occlusion * width);
+    if ( occluderWidth > 0 ) {
+        cvRectangle(image, cvPoint((int)occluderX, 0),
+                    cvPoint((int)occluderX + occluderWidth - 1, height - 1),
+                    cvScalarAll(90), CV_FILLED);
+    }
+
+    for ( unsigned int i=0; i<blobs.size(); i++ ) {
+        blobs[i].visible = !( occluderWidth > 0 &&
+                              blobs[i].x >= occluderX &&
+                              blobs[i].x < occluderX + occluderWidth );
+    }
+
+    if ( param.noise )
+        addNoise(image);
+}
+
+void SyntheticScene::move()
+{
+    for ( unsigned int i=0; i<blobs.size(); i++ ) {
+        Blob &blob = blobs[i];
+        blob.x += blob.vx;
+        blob.y += blob.vy;
+
+        // Отражение от краев, круг целиком остается в кадре
+        if ( blob.x < param.radius )          { blob.x = 2*param.radius - blob.x;           blob.vx = -blob.vx; }
+        if ( blob.x > width - param.radius )  { blob.x = 2*(width - param.radius) - blob.x;  blob.vx = -blob.vx; }
+        if ( blob.y < param.radius )          { blob.y = 2*param.radius - blob.y;           blob.vy = -blob.vy; }
+        if ( blob.y > height - param.radius ) { blob.y = 2*(height - param.radius) - blob.y; blob.vy = -blob.vy; }
+    }
+
+    int occluderWidth = (int)(param.occlusion * width);
+    occluderX += occluderSpeed;
+    if ( occluderX < 0 )                     { occluderX = -occluderX;                             occluderSpeed = -occluderSpeed; }
+    if ( occluderX > width - occluderWidth ) { occluderX = 2*(width - occluderWidth) - occluderX;  occluderSpeed = -occluderSpeed; }
+}
+
+void SyntheticScene::addNoise(IplImage *image)
+{
+    int rowSize = width * 3;
+
+    for ( int y=0; y<height; y++ ) {
+        uchar *row = (uchar *)(image->imageData + y * image->widthStep);
+        unsigned int offset = nextRandom() % NOISE_TABLE_SIZE;
+
+        for ( int x=0; x<rowSize; x++ ) {
+            int value = row[x] + noiseTable[offset];
+            row[x] = value < 0 ? 0 : (value > 255 ? 255 : value);
+            if ( ++offset == NOISE_TABLE_SIZE )
+                offset = 0;
+        }
+    }
+}
+
+// xorshift32: одинаковая последовательность на всех платформах
+unsigned int SyntheticScene::nextRandom()
+{
+    random ^= random << 13;
+    random ^= random >> 17;
+    random ^= random << 5;
+    return random;
+}
+
+double SyntheticScene::nextDouble()
+{
+    return nextRandom() / 4294967296.0;
+}
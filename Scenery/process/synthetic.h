@@ -0,0 +1,71 @@
+#ifndef SYNTHETIC_H
+#define SYNTHETIC_H
+
+#include <opencv/cxcore.h>
+
+#include <vector>
+
+using std::vector;
+
+// Искусственная сцена для замеров и проверки трекинга: N цветных кругов
+// движутся с постоянной скоростью и отражаются от краев кадра, поверх
+// них может двигаться вертикальная полоса-заслонка. Для каждого кадра
+// известны истинные положения кругов. Генерация детерминирована seed
+class SyntheticScene
+{
+public:
+    struct Param {
+        int blobs;          // Количество кругов
+        int radius;         // Радиус, пикселей
+        double speed;       // Скорость, пикселей за кадр
+        int noise;          // Амплитуда шума яркости фона и кругов, 0..127
+        double occlusion;   // Ширина заслонки в долях кадра, 0 - без нее
+        unsigned int seed;
+    };
+
+    struct Blob {
+        unsigned int id;    // Номер круга, с 1
+        double x;           // Центр
+        double y;
+        double vx;          // Скорость, пикселей за кадр
+        double vy;
+        bool visible;       // Центр не закрыт заслонкой
+    };
+
+    SyntheticScene(int width, int height);
+
+    static Param defaultParam();
+
+    // Начать сцену заново с параметрами param
+    void setParam(Param param);
+    Param getParam() { return param; }
+
+    // Нарисовать следующий кадр. Положения кругов в getBlobs()
+    // соответствуют нарисованному кадру
+    void render(IplImage *image);
+
+    const vector<Blob> &getBlobs() { return blobs; }
+
+private:
+    int width;
+    int height;
+    Param param;
+
+    vector<Blob> blobs;
+    vector<CvScalar> colors;
+    double occluderX;           // Левый край заслонки
+    double occluderSpeed;
+
+    // Таблица шума: строка кадра берет отрезок со случайного места,
+    // чтобы не генерировать шум для каждого пикселя 4K кадра
+    vector<signed char> noiseTable;
+
+    unsigned int random;
+    unsigned int nextRandom();
+    double nextDouble();    // 0..1
+
+    void move();
+    void addNoise(IplImage *image);
+};
+
+#endif // SYNTHETIC_H
@@ -0,0 +1,179 @@
+#include "threadpool.h"
+#include "tracer.h"
+
+#include <QMutexLocker>
+
+// Полос на поток: меньше - меньше накладных расходов,
+// больше - лучше выравнивается нагрузка
+#define BANDS_PER_THREAD 4
+
+class ThreadPool::Worker : public QThread
+{
+public:
+    Worker(ThreadPool *pool, int index) { this->pool = pool; this->index = index; }
+
+protected:
+    void run()
+    {
+        Tracer::setThreadName(QString("%1.worker%2").arg(pool->name).arg(index));
+        pool->work(index);
+    }
+
+private:
+    ThreadPool *pool;
+    int index;
+};
+
+ThreadPool::ThreadPool(int threadCount)
+{
+    this->threadCount = qMax(1, threadCount);
+    name = "pool";
+    queues = 0;
+    generation = 0;
+    active = 0;
+    stopped = false;
+    task = 0;
+    rows = 0;
+    band = 1;
+
+    startWorkers();
+}
+
+ThreadPool::~ThreadPool()
+{
+    stopWorkers();
+}
+
+void ThreadPool::setThreadCount(int threadCount)
+{
+    threadCount = qMax(1, threadCount);
+    if ( threadCount == this->threadCount )
+        return;
+
+    stopWorkers();
+    this->threadCount = threadCount;
+    startWorkers();
+}
+
+void ThreadPool::startWorkers()
+{
+    queues = new Queue[threadCount];
+
+    stopped = false;
+    for ( int i=1; i<threadCount; i++ ) {
+        Worker *worker = new Worker(this, i);
+        worker->start();
+        workers.push_back(worker);
+    }
+}
+
+void ThreadPool::stopWorkers()
+{
+    mutex.lock();
+    stopped = true;
+    startCondition.wakeAll();
+    mutex.unlock();
+
+    for ( unsigned int i=0; i<workers.size(); i++ ) {
+        workers[i]->wait();
+        delete workers[i];
+    }
+    workers.clear();
+
+    delete [] queues;
+    queues = 0;
+}
+
+void ThreadPool::parallelFor(int rows, RowTask &task)
+{
+    if ( threadCount == 1 || rows < 2 ) {
+        task.run(0, rows, 0);
+        return;
+    }
+
+    mutex.lock();
+
+    // Полоса может быть и из одной строки: parallelFor делит
+    // не только строки кадра, но и, например, полосы кластеризации
+    int bands = qMin(rows, threadCount * BANDS_PER_THREAD);
+    this->task = &task;
+    this->rows = rows;
+    band = (rows + bands - 1) / bands;
+    bands = (rows + band - 1) / band;
+
+    for ( int i=0; i<threadCount; i++ ) {
+        queues[i].next.fetchAndStoreOrdered(bands * i / threadCount);
+        queues[i].end = bands * (i+1) / threadCount;
+    }
+    remaining.fetchAndStoreOrdered(bands);
+
+    generation++;
+    startCondition.wakeAll();
+    mutex.unlock();
+
+    execute(0);
+
+    // Все полосы уже разобраны, ждем потоки, которые их еще обрабатывают
+    mutex.lock();
+    while ( active > 0 )
+        doneCondition.wait(&mutex);
+    mutex.unlock();
+}
+
+void ThreadPool::work(int index)
+{
+    int seen = 0;
+
+    mutex.lock();
+    for (;;) {
+        while ( generation == seen && !stopped )
+            startCondition.wait(&mutex);
+
+        if (stopped)
+            break;
+
+        seen = generation;
+
+        // Поток мог проснуться, когда задание уже выполнено.
+        // Присоединиться можно только под mutex, пока есть полосы,
+        // тогда parallelFor дождется этого потока
+        if ( remaining.fetchAndAddOrdered(0) == 0 )
+            continue;
+
+        active++;
+        mutex.unlock();
+
+        execute(index);
+
+        mutex.lock();
+        active--;
+        if ( active == 0 )
+            doneCondition.wakeAll();
+    }
+    mutex.unlock();
+}
+
+void ThreadPool::execute(int index)
+{
+    TraceSpan span("rows");
+
+    int done = 0;
+
+    for ( int k=0; k<threadCount; k++ ) {
+        Queue &queue = queues[(index + k) % threadCount];
+
+        for (;;) {
+            int b = queue.next.fetchAndAddOrdered(1);
+            if ( b >= queue.end )
+                break;
+
+            int begin = b * band;
+            int end = qMin(rows, begin + band);
+            task->run(begin, end, index);
+            done++;
+        }
+    }
+
+    if (done)
+        remaining.fetchAndAddOrdered(-done);
+}
@@ -0,0 +1,114 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+#include <QString>
+
+#include <vector>
+
+using std::vector;
+
+// Обработка части строк изображения для ThreadPool::parallelFor
+class RowTask
+{
+public:
+    virtual ~RowTask() {}
+
+    // Обработать строки [begin, end). thread - номер потока
+    // от 0 до ThreadPool::getThreadCount()-1, для буферов,
+    // которые у каждого потока свои
+    virtual void run(int begin, int end, int thread) = 0;
+};
+
+// Метод объекта как RowTask
+template <class T>
+class RowMethod : public RowTask
+{
+public:
+    typedef void (T::*Method)(int begin, int end, int thread);
+
+    RowMethod(T *object, Method method) { this->object = object; this->method = method; }
+    void run(int begin, int end, int thread) { (object->*method)(begin, end, thread); }
+
+private:
+    T *object;
+    Method method;
+};
+
+// Постоянные потоки для попиксельных этапов обработки кадра.
+//
+// parallelFor делит строки на полосы и раздает каждому потоку свой
+// непрерывный участок полос. Закончив свой участок, поток забирает
+// полосы с начала участков других потоков, так что неравномерная
+// нагрузка (например, кадр с движением только внизу) выравнивается.
+// Вызывающий поток работает как поток номер 0.
+class ThreadPool
+{
+public:
+    ThreadPool(int threadCount = 1);
+    ~ThreadPool();
+
+    // Количество потоков вместе с вызывающим. При 1 задачи
+    // выполняются в вызывающем потоке без синхронизации
+    void setThreadCount(int threadCount);
+    int getThreadCount() { return threadCount; }
+
+    // Имя потоков в трассировке: "name.worker1" и т.д.
+    // Применяется к потокам, запущенным после вызова
+    void setName(QString name) { this->name = name; }
+
+    // Выполнить task для строк [0, rows) и дождаться окончания.
+    // Вызывать только из одного потока
+    void parallelFor(int rows, RowTask &task);
+
+    template <class T>
+    void parallelFor(int rows, T *object, typename RowMethod<T>::Method method)
+    {
+        RowMethod<T> task(object, method);
+        parallelFor(rows, task);
+    }
+
+private:
+    class Worker;
+    friend class Worker;
+
+    // Участок полос одного потока. Выровнен по строке кэша,
+    // чтобы потоки не мешали друг другу счетчиками
+    struct Queue {
+        QAtomicInt next;    // Следующая свободная полоса
+        int end;
+        char padding[64 - sizeof(QAtomicInt) - sizeof(int)];
+    };
+
+    int threadCount;
+    QString name;
+    vector<Worker *> workers;
+    Queue *queues;
+
+    QMutex mutex;
+    QWaitCondition startCondition;
+    QWaitCondition doneCondition;
+    int generation;         // Номер задания, растет с каждым parallelFor
+    int active;             // Сколько потоков выполняют задание
+    bool stopped;
+
+    // Текущее задание
+    RowTask *task;
+    int rows;
+    int band;
+    QAtomicInt remaining;   // Сколько полос еще не обработано
+
+    void startWorkers();
+    void stopWorkers();
+
+    // Цикл потока index
+    void work(int index);
+
+    // Обработать свои полосы, затем чужие
+    void execute(int index);
+};
+
+#endif // THREADPOOL_H
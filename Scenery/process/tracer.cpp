@@ -0,0 +1,192 @@
+#include "tracer.h"
+#include "clock.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <QThreadStorage>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QList>
+#include <QVector>
+
+// Сколько событий помещается в буфер одного потока
+#define TRACE_EVENTS 65536
+
+volatile bool Tracer::enabled = false;
+QAtomicInt Tracer::dropped(0);
+
+struct TraceEvent {
+    const char *name;
+    qint64 start;
+    qint64 duration;
+    unsigned int frame;
+};
+
+// Буфер пишет только его поток, поэтому достаточно опубликовать
+// количество записанных событий после записи самого события
+struct TraceBuffer {
+    int tid;
+    QString threadName;
+    QVector<TraceEvent> events;
+    QAtomicInt count;
+};
+
+// Имя потока хранится отдельно от буфера: буфер на TRACE_EVENTS событий
+// создается только при первом записанном событии, поэтому потоки,
+// которые ничего не пишут, не занимают память.
+// QThreadStorage удаляет свои данные при завершении потока,
+// а буфер должен дожить до сохранения трассы
+struct TraceThread {
+    QString name;
+    TraceBuffer *buffer;
+};
+
+static QMutex buffersMutex;
+static QList<TraceBuffer *> buffers;
+static QThreadStorage<TraceThread *> threads;
+
+static TraceThread *currentThread()
+{
+    if ( !threads.hasLocalData() ) {
+        TraceThread *thread = new TraceThread;
+        thread->buffer = 0;
+        threads.setLocalData(thread);
+    }
+
+    return threads.localData();
+}
+
+static TraceBuffer *threadBuffer()
+{
+    TraceThread *thread = currentThread();
+
+    if ( !thread->buffer ) {
+        TraceBuffer *buffer = new TraceBuffer;
+        buffer->events.resize(TRACE_EVENTS);
+
+        QMutexLocker locker(&buffersMutex);
+        buffer->tid = buffers.size() + 1;
+        buffer->threadName = thread->name.isEmpty()
+                ? QString("thread %1").arg(buffer->tid) : thread->name;
+        buffers.append(buffer);
+
+        thread->buffer = buffer;
+    }
+
+    return thread->buffer;
+}
+
+void Tracer::setThreadName(QString name)
+{
+    TraceThread *thread = currentThread();
+    thread->name = name;
+
+    if ( thread->buffer ) {
+        QMutexLocker locker(&buffersMutex);
+        thread->buffer->threadName = name;
+    }
+}
+
+void Tracer::complete(const char *name, qint64 start, qint64 duration, unsigned int frame)
+{
+    if ( !enabled )
+        return;
+
+    TraceBuffer *buffer = threadBuffer();
+
+    int i = buffer->count.fetchAndAddOrdered(0);
+    if ( i >= TRACE_EVENTS ) {
+        dropped.fetchAndAddOrdered(1);
+        return;
+    }
+
+    TraceEvent &event = buffer->events[i];
+    event.name = name;
+    event.start = start;
+    event.duration = duration;
+    event.frame = frame;
+
+    buffer->count.fetchAndStoreOrdered(i + 1);
+}
+
+// Строка в кавычках для JSON
+static QString jsonString(const QString &text)
+{
+    QString result = "\"";
+    for ( int i=0; i<text.size(); i++ ) {
+        QChar c = text[i];
+        if ( c == '"' || c == '\\' )
+            result += QString("\\") + c;
+        else if ( c.unicode() < 0x20 )
+            result += QString("\\u%1").arg(c.unicode(), 4, 16, QChar('0'));
+        else
+            result += c;
+    }
+    return result + "\"";
+}
+
+bool Tracer::save(QString file)
+{
+    bool wasEnabled = enabled;
+    enabled = false;
+
+    QFile json(file);
+    if ( !json.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text) ) {
+        enabled = wasEnabled;
+        return false;
+    }
+
+    QTextStream out(&json);
+    out.setCodec("UTF-8");
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+
+    QMutexLocker locker(&buffersMutex);
+    bool first = true;
+
+    for ( int b=0; b<buffers.size(); b++ ) {
+        TraceBuffer *buffer = buffers[b];
+
+        out << (first ? "" : ",\n")
+            << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->tid
+            << ", \"args\": {\"name\": " << jsonString(buffer->threadName) << "}}";
+        first = false;
+
+        int count = buffer->count.fetchAndAddOrdered(0);
+        for ( int i=0; i<count; i++ ) {
+            const TraceEvent &event = buffer->events[i];
+            out << ",\n{\"name\": \"" << event.name << "\", \"ph\": \"X\", \"pid\": 1"
+                << ", \"tid\": " << buffer->tid
+                << ", \"ts\": " << event.start
+                << ", \"dur\": " << event.duration
+                << ", \"args\": {\"frame\": " << event.frame << "}}";
+        }
+    }
+
+    out << "\n]}\n";
+
+    enabled = wasEnabled;
+    return true;
+}
+
+void Tracer::clear()
+{
+    QMutexLocker locker(&buffersMutex);
+
+    for ( int b=0; b<buffers.size(); b++ ) {
+        buffers[b]->count.fetchAndStoreOrdered(0);
+    }
+    dropped.fetchAndStoreOrdered(0);
+}
+
+TraceSpan::TraceSpan(const char *name, unsigned int frame)
+{
+    this->name = name;
+    this->frame = frame;
+    start = Tracer::isEnabled() ? Clock::now() : 0;
+}
+
+TraceSpan::~TraceSpan()
+{
+    if ( start && Tracer::isEnabled() )
+        Tracer::complete(name, start, Clock::now() - start, frame);
+}
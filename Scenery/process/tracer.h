@@ -0,0 +1,55 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QString>
+#include <QAtomicInt>
+
+// Запись отрезков времени работы потоков в формате trace event
+// (chrome://tracing, Perfetto). Каждый поток пишет в свой буфер без
+// блокировок; пока запись выключена, отрезок стоит одну проверку флага.
+// Если буфер потока заполнен, новые события отбрасываются
+class Tracer
+{
+public:
+    static void setEnabled(bool enabled) { Tracer::enabled = enabled; }
+    static bool isEnabled() { return enabled; }
+
+    // Имя текущего потока в трассе. Буфер событий потока создается
+    // только при первом записанном событии
+    static void setThreadName(QString name);
+
+    // Отрезок name, начавшийся в start и длившийся duration мкс (Clock)
+    static void complete(const char *name, qint64 start, qint64 duration,
+                         unsigned int frame = 0);
+
+    // Сохранить все записанные события. Запись на время сохранения
+    // выключается
+    static bool save(QString file);
+
+    // Удалить записанные события. Вызывать при выключенной записи
+    static void clear();
+
+    // Сколько событий не поместилось в буферы
+    static int getDropped() { return dropped.fetchAndAddOrdered(0); }
+
+private:
+    static volatile bool enabled;
+    static QAtomicInt dropped;
+};
+
+// Отрезок от создания до удаления объекта
+class TraceSpan
+{
+public:
+    TraceSpan(const char *name, unsigned int frame = 0);
+    ~TraceSpan();
+
+    void setFrame(unsigned int frame) { this->frame = frame; }
+
+private:
+    const char *name;
+    unsigned int frame;
+    qint64 start;
+};
+
+#endif // TRACER_H
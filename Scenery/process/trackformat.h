@@ -0,0 +1,92 @@
+#ifndef TRACKFORMAT_H
+#define TRACKFORMAT_H
+
+// Формат кольца треков в разделяемой памяти (SharedSink).
+// Файл не зависит от Qt и OpenCV: его можно подключить
+// в программе отрисовки, которая читает треки из другого процесса.
+//
+// Сегмент: TrackRingHeader, затем slotCount слотов по slotSize байт.
+// Слот: TrackSlotHeader, затем данные кадра:
+//   TrackFrame
+//   TrackArea    [areaCount]
+//   TrackSeqArea [seqAreaCount]
+//   int          [contourCount]       - количество точек каждого контура
+//   TrackPoint   [contourPointCount]  - точки всех контуров подряд
+// Все поля 32-битные, порядок байт - как у записывающей машины.
+//
+// Запись (один писатель на сегмент), seqlock:
+//   sequence слота становится нечетным, пишутся данные,
+//   sequence становится четным, затем latest = номер слота.
+// Чтение без блокировок:
+//   1. slot = latest, s1 = slot.sequence; если s1 нечетный - повторить
+//   2. скопировать данные слота
+//   3. s2 = slot.sequence; если s2 != s1 - слот перезаписан, повторить
+// Между шагами читателю нужен барьер памяти на чтение.
+
+#define TRACK_MAGIC   0x4b435254    // "TRCK"
+#define TRACK_VERSION 2
+
+struct TrackRingHeader {
+    unsigned int magic;
+    unsigned int version;
+    unsigned int slotCount;
+    unsigned int slotSize;          // Размер слота вместе с TrackSlotHeader
+    volatile unsigned int latest;   // Номер последнего записанного слота
+    volatile unsigned int frames;   // Записано кадров с запуска (0 - еще нет)
+};
+
+struct TrackSlotHeader {
+    volatile int sequence;          // Нечетный, пока слот пишется
+    unsigned int size;              // Размер данных после заголовка
+};
+
+struct TrackFrame {
+    unsigned int number;            // Номер кадра захвата
+    unsigned int latency;           // От захвата до публикации, мкс
+    int width;                      // Размер кадра, в котором даны координаты
+    int height;
+    unsigned int areaCount;
+    unsigned int seqAreaCount;
+    unsigned int contourCount;
+    unsigned int contourPointCount;
+    unsigned int truncated;         // Не все данные поместились в слот
+};
+
+// Моменты региона: центр масс в координатах кадра, главная ось
+// в координатах камеры (угол к оси X в радианах, длины осей).
+// Для алгоритмов без маски точек pixels = 0, центр масс -
+// центр прямоугольника
+struct TrackMoments {
+    int pixels;
+    int centroidX;
+    int centroidY;
+    float orientation;
+    float majorAxis;
+    float minorAxis;
+};
+
+struct TrackArea {
+    int x;
+    int y;
+    int width;
+    int height;
+    TrackMoments moments;
+};
+
+struct TrackSeqArea {
+    unsigned int number;            // Номер последовательности (трека)
+    int x;
+    int y;
+    int prevX;
+    int prevY;
+    int width;
+    int height;
+    TrackMoments moments;
+};
+
+struct TrackPoint {
+    int x;
+    int y;
+};
+
+#endif // TRACKFORMAT_H
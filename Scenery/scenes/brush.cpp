@@ -32,9 +32,9 @@ void Brush::setup()
 void Brush::paint()
 {
     if (mode == "Line") {
-        SeqAreas &seqAreas = getSeqAreas(0);
+        const SeqAreas &seqAreas = getSeqAreas(0);
         for (unsigned int i=0; i<seqAreas.size(); i++) {
-            SeqArea &seqArea = seqAreas.at(i);
+            const SeqArea &seqArea = seqAreas.at(i);
             if (seqArea.number > 1 && seqArea.length > blotLimit) {
                 color(lineColor);
                 lineWidth(lineSize);
@@ -43,9 +43,9 @@ void Brush::paint()
         }
     }
     else if (mode == "Blots") {
-        SeqAreas &seqAreas = getSeqAreas(0);
+        const SeqAreas &seqAreas = getSeqAreas(0);
         for (unsigned int i=0; i<seqAreas.size(); i++) {
-            SeqArea &seqArea = seqAreas.at(i);
+            const SeqArea &seqArea = seqAreas.at(i);
             if (seqArea.number > 1 && seqArea.length > blotLimit) {
                 glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_BLEND);
                 GLfloat envColor2[4] = {blotColor.r, blotColor.g, blotColor.b, 0};
@@ -50,9 +50,9 @@ void Cage::paint()
     background(backColor);
 
     applyWave();
-    Areas &areas = getAreas(0);
+    const Areas &areas = getAreas(0);
     for (unsigned int i=0; i<areas.size(); i++) {
-        Area &area = areas.at(i);
+        const Area &area = areas.at(i);
 
         if (area.pt[0] > 0 && area.pt[1] > 0 && area.pt[0] < width && area.pt[1] < height) {
             int x1 = (area.pt[0]-(area.width/2 ))/cellSize - influence;
@@ -105,7 +105,7 @@ void Cage::applyWave()
     bool isCenter = false;
     float cx = 0;
     float cy = 0;
-    Areas &areas = getAreas(0);
+    const Areas &areas = getAreas(0);
     if (areas.size()>0) {
         cx = areas.at(0).pt[0];
         cy = areas.at(0).pt[1];
@@ -113,7 +113,7 @@ void Cage::applyWave()
     }
 
     for (unsigned int i=0; i<areas.size(); i++) {
-        Area &area = areas.at(i);
+        const Area &area = areas.at(i);
         cx = (cx + area.pt[0])/2.0;
         cy = (cy + area.pt[1])/2.0;
     }
@@ -11,7 +11,7 @@ void Inking::setup()
 
 void Inking::paint()
 {
-    Contours &contours = getContours(0);
+    const Contours &contours = getContours(0);
 
     background(0.0f, 0.0f, 0.0f, 1.0f);
 
@@ -19,7 +19,7 @@ void Inking::paint()
     lineWidth(3);
 
     for (uint i=0; i<contours.size(); ++i) {
-        Contour &contour = contours.at(i);
+        const Contour &contour = contours.at(i);
         ContourPt pt(0, 0);
         for (uint j=0; j<contour.size(); ++j )
         {
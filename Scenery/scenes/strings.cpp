@@ -53,9 +53,9 @@ void Strings::paint()
         float yAverage = height/2;
         bool isFirstAverage = true;
 
-        SeqAreas &seqAreas = getSeqAreas(0);
+        const SeqAreas &seqAreas = getSeqAreas(0);
         for (unsigned int j=0; j<seqAreas.size(); j++) {
-            SeqArea &seqArea = seqAreas.at(j);
+            const SeqArea &seqArea = seqAreas.at(j);
             if (seqArea.number > 1) {
                 bool isFound = false;
 
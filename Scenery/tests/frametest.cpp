@@ -0,0 +1,143 @@
+// Проверка пути кадра Input -> Process -> результат.
+//
+// Synthetic рисует кадры прямо в кольцо, поток обработки берет их
+// ссылкой, а этот поток, как Manager, забирает результаты. После
+// прогрева (пул кольца заполнен, буферы Process созданы) на каждом
+// кадре не должно быть ни одной копии изображения и ни одного
+// нового буфера. Загрузка кадров, как в benchmark, здесь не нужна,
+// поэтому счетчики FramePool относятся только к этому пути.
+//
+// Собирается вместе с исходниками process (нужны Qt и OpenCV),
+// проще всего через tests/run.sh.
+//
+//   frametest [--frames N] [--size WxH]
+//
+// Код возврата 0 - проверка пройдена, 1 - нет.
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QThread>
+
+#include <stdio.h>
+
+#include "../process/clock.h"
+#include "../process/input.h"
+#include "../process/process.h"
+
+// Сколько первых результатов не учитывается
+#define WARMUP_FRAMES 10
+
+// Сколько можно ждать следующего результата, мкс
+#define RESULT_TIMEOUT 10000000
+
+// QThread::msleep() в Qt 4 защищенный
+class Sleep : public QThread
+{
+public:
+    static void ms(unsigned long ms) { QThread::msleep(ms); }
+};
+
+// Ждет результата новее number, как Manager::step. 0 - не дождались
+static const ProcessResult *waitResult(Process &process, unsigned int number)
+{
+    qint64 start = Clock::now();
+    while ( process.getResultNumber() == number ) {
+        if ( Clock::now() - start > RESULT_TIMEOUT )
+            return 0;
+        Sleep::ms(1);
+    }
+    return process.takeResult();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QStringList args = a.arguments();
+
+    int frames = 200;
+    int width = 640;
+    int height = 480;
+
+    for ( int i=1; i<args.size(); i++ ) {
+        if ( args[i] == "--frames" && i+1 < args.size() )
+            frames = args[++i].toInt();
+        else if ( args[i] == "--size" && i+1 < args.size() ) {
+            QStringList size = args[++i].split('x');
+            if ( size.size() == 2 ) {
+                width = size[0].toInt();
+                height = size[1].toInt();
+            }
+        }
+        else {
+            fprintf(stderr, "usage: frametest [--frames N] [--size WxH]\n");
+            return 2;
+        }
+    }
+
+    FramePool::resetCounters();
+
+    // Кадры не пропускаются, чтобы каждый прошел весь путь
+    Input input(Input::Synthetic, "", width, height);
+    input.setReplayRate(Input::ReplayFast);
+
+    Process process(width, height);
+    process.setInput(input.getRing());
+    process.setMode(Process::ProcessColor);
+    process.setClusterMode(Clustering::ClusterSimple);
+
+    input.start();
+    process.start();
+
+    bool ok = true;
+    unsigned int number = 0;
+    int allocations = 0;
+    int copies = 0;
+    int received = 0;
+
+    while ( received < WARMUP_FRAMES + frames ) {
+        const ProcessResult *result = waitResult(process, number);
+        if ( !result ) {
+            fprintf(stderr, "no result after frame %u\n", number);
+            ok = false;
+            break;
+        }
+
+        if ( result->frame.isNull() || result->frame.getNumber() != result->number ) {
+            fprintf(stderr, "result %u does not hold its frame\n", result->number);
+            ok = false;
+        }
+
+        number = result->number;
+        received++;
+
+        if ( received == WARMUP_FRAMES ) {
+            allocations = FramePool::getAllocations();
+            copies = FramePool::getCopies();
+        }
+    }
+
+    process.stop();
+    input.stop();
+    process.wait();
+    input.wait();
+
+    int newAllocations = FramePool::getAllocations() - allocations;
+    int newCopies = FramePool::getCopies() - copies;
+
+    // Пул кольца: кадр в записи, последний кадр и RING_PINNED
+    // закрепленных обработкой
+    int maxAllocations = RING_PINNED + 2;
+
+    printf("frames %d (after %d warmup), %dx%d\n", frames, WARMUP_FRAMES, width, height);
+    printf("buffers %d (at most %d), new after warmup %d\n",
+           FramePool::getAllocations(), maxAllocations, newAllocations);
+    printf("copies after warmup %d\n", newCopies);
+    printf("skipped %u\n", process.getSkipped());
+
+    if ( newCopies != 0 || newAllocations != 0
+      || FramePool::getAllocations() > maxAllocations )
+        ok = false;
+
+    printf("%s\n", ok ? "ok" : "FAIL");
+    return ok ? 0 : 1;
+}
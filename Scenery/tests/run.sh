@@ -0,0 +1,46 @@
+#!/bin/sh
+# Сборка и запуск тестов. Запуск из Scenery:
+#
+#   sh tests/run.sh
+#
+# simdtest не нужны ни Qt, ни OpenCV. frametest собирается, только если
+# pkg-config находит QtCore и opencv, иначе пропускается.
+# Программы собираются в tests/build, код возврата 1 - есть ошибки.
+
+cd "$(dirname "$0")/.." || exit 1
+
+CXX=${CXX:-g++}
+BUILD=tests/build
+mkdir -p $BUILD
+
+failed=0
+
+echo "== simdtest"
+if $CXX -O2 -o $BUILD/simdtest tests/simdtest.cpp process/processsimd.cpp; then
+    $BUILD/simdtest || failed=1
+else
+    failed=1
+fi
+
+echo "== frametest"
+if pkg-config --exists QtCore opencv; then
+    # Только то, от чего зависят Input и Process, без получателей результатов
+    SOURCES="process/background.cpp process/clock.cpp process/clustering.cpp
+             process/colortable.cpp process/framebuffer.cpp process/framefile.cpp
+             process/framering.cpp process/framestats.cpp process/haarloader.cpp
+             process/hitmask.cpp process/input.cpp process/process.cpp
+             process/processfilters.cpp process/processresult.cpp
+             process/processsimd.cpp process/processtools.cpp
+             process/stagetimer.cpp process/synthetic.cpp process/threadpool.cpp
+             process/tracer.cpp"
+    if $CXX -O2 -o $BUILD/frametest tests/frametest.cpp $SOURCES \
+            $(pkg-config --cflags --libs QtCore opencv) -lpthread; then
+        $BUILD/frametest || failed=1
+    else
+        failed=1
+    fi
+else
+    echo "skipped: QtCore or opencv not found by pkg-config"
+fi
+
+exit $failed
@@ -0,0 +1,415 @@
+// Проверка векторных ядер ProcessSimd на целых кадрах.
+//
+// Каждое ядро обрабатывает кадр построчно, как это делает Process,
+// а маски (и модель фона) целиком сравниваются с результатом
+// скалярного варианта. Скалярный вариант в свою очередь сверяется
+// с эталоном:
+//
+// Color: все 2^24 цветов в одном кадре, условие по таблицам RGB2HSV,
+// которые Process использовал до ProcessSimd:
+// (Hmin <= H <= Hmax) ^ invert && S >= Smin && V >= Vmin.
+// Первые диапазоны - граничные, остальные случайные (--ranges N).
+// Motion: кадр со всеми парами значений каждого канала и кадры
+// с шумом при разных порогах, эталон - сумма модулей разностей.
+// Background: последовательность кадров с дрейфом яркости и
+// движущимся прямоугольником, маска и модель после каждого кадра.
+//
+// Ширина кадра не кратна 16 и 32, поэтому проверяются и хвосты
+// векторных циклов. Программе не нужны Qt и OpenCV. Запуск из Scenery:
+//
+//   g++ -O2 -o simdtest tests/simdtest.cpp process/processsimd.cpp && ./simdtest
+//
+// Код возврата 0 - все ядра совпали, 1 - есть расхождения.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include "../process/processsimd.h"
+
+using std::vector;
+
+#define FRAME_WIDTH 1000
+
+static const char *simdName(ProcessSimd::Instructions instructions)
+{
+    switch (instructions) {
+    case ProcessSimd::Scalar: return "scalar";
+    case ProcessSimd::SSE2:   return "sse2";
+    case ProcessSimd::AVX2:   return "avx2";
+    }
+    return "";
+}
+
+// Кадр BGR и маска, строки без выравнивания
+struct Frame {
+    int width;
+    int height;
+    vector<unsigned char> bgr;
+
+    Frame(int width, int height) : width(width), height(height), bgr(3*width*height, 0) {}
+    unsigned char *row(int y) { return &bgr[3*y*width]; }
+};
+
+// Первое расхождение двух масок
+static bool sameMask(const vector<unsigned char> &expected, const vector<unsigned char> &hit,
+                     int width, const char *what)
+{
+    for ( unsigned int i=0; i<hit.size(); i++ ) {
+        if ( hit[i] != expected[i] ) {
+            fprintf(stderr, "  %s: first mismatch at x=%d y=%d, got %d expected %d\n",
+                    what, int(i % width), int(i / width), hit[i], expected[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+// ====================================================================
+// Color
+// ====================================================================
+
+struct ColorCase {
+    bool invert;
+    unsigned char Hmin;
+    unsigned char Hmax;
+    unsigned char Smin;
+    unsigned char Vmin;
+};
+
+// Границы диапазона тона и нулевые пороги S и V - места,
+// где целочисленная формула чаще всего расходится с таблицей
+static const ColorCase edgeCases[] = {
+    { false,   0, 255,   0,   0 },
+    { false,   0,   0,   0,   0 },
+    { true,    0,   0,   0,   0 },
+    { false, 255, 255,   0,   0 },
+    { false,   1, 254,   1,   1 },
+    { true,    1, 254,   1,   1 },
+    { false,   0, 127, 255,   0 },
+    { false, 128, 255,   0, 255 },
+    { false,  42,  43, 128, 128 },
+    { true,  200,  30,  10,  10 },
+    { false, 200,  30,  10,  10 }
+};
+
+// H, S и V одного цвета так же, как их считал ProcessTools::RGB2HSVi
+// при заполнении таблиц
+static void tableHSV(int r, int g, int b,
+                     unsigned char &H, unsigned char &S, unsigned char &V)
+{
+    int min = r < g ? r : g;
+    min = min < b ? min : b;
+    int max = r > g ? r : g;
+    max = max > b ? max : b;
+    int delta = max - min;
+
+    int h = 0, s = 0;
+    if ( max > 0 && delta > 0 ) {
+        s = (double)delta / (double)max * 255.0;
+
+        double dh;
+        if ( r >= max )
+            dh = (double)( g - b ) / (double)delta;
+        else if ( g >= max )
+            dh = 2 + (double)( b - r ) / (double)delta;
+        else
+            dh = 4 + (double)( r - g ) / (double)delta;
+
+        dh *= 60;
+        if ( dh < 0 )
+            dh += 360;
+        h = (int)dh;
+    }
+
+    H = (unsigned char)(255.0*(double)h/360.0);
+    S = (unsigned char)s;
+    V = (unsigned char)max;
+}
+
+// Кадр, в котором пиксель i имеет цвет i (b - младший байт)
+static Frame allColors(vector<unsigned char> &H, vector<unsigned char> &S,
+                       vector<unsigned char> &V)
+{
+    const int colors = 256*256*256;
+    Frame frame(FRAME_WIDTH, (colors + FRAME_WIDTH - 1) / FRAME_WIDTH);
+    H.assign(frame.width * frame.height, 0);
+    S.assign(frame.width * frame.height, 0);
+    V.assign(frame.width * frame.height, 0);
+
+    for ( int i=0; i<frame.width*frame.height; i++ ) {
+        int c = i % colors;
+        int r = c >> 16, g = (c >> 8) & 0xff, b = c & 0xff;
+        frame.bgr[3*i+0] = b;
+        frame.bgr[3*i+1] = g;
+        frame.bgr[3*i+2] = r;
+        tableHSV(r, g, b, H[i], S[i], V[i]);
+    }
+
+    return frame;
+}
+
+static void findColorFrame(Frame &frame, vector<unsigned char> &hit,
+                           const ProcessSimd::ColorRange &range)
+{
+    hit.assign(frame.width * frame.height, 0);
+    for ( int y=0; y<frame.height; y++ )
+        ProcessSimd::findColor(frame.row(y), &hit[y*frame.width], frame.width, range);
+}
+
+static bool checkColor(Frame &frame, const vector<unsigned char> &H,
+                       const vector<unsigned char> &S, const vector<unsigned char> &V,
+                       const ColorCase &c, ProcessSimd::Instructions best)
+{
+    vector<unsigned char> expected(H.size());
+    for ( unsigned int i=0; i<H.size(); i++ ) {
+        bool h = H[i] >= c.Hmin && H[i] <= c.Hmax;
+        expected[i] = ( (h ^ c.invert) && S[i] >= c.Smin && V[i] >= c.Vmin ) ? 255 : 0;
+    }
+
+    ProcessSimd::ColorRange range =
+            ProcessSimd::colorRange(c.invert, c.Hmin, c.Hmax, c.Smin, c.Vmin);
+
+    vector<unsigned char> scalar;
+    ProcessSimd::setInstructions(ProcessSimd::Scalar);
+    findColorFrame(frame, scalar, range);
+
+    printf("color  H %3d..%3d%s S>=%3d V>=%3d", c.Hmin, c.Hmax,
+           c.invert ? " inv" : "    ", c.Smin, c.Vmin);
+    bool ok = sameMask(expected, scalar, frame.width, "scalar vs table");
+    printf(" scalar %s", ok ? "ok" : "FAIL");
+
+    for ( int i=ProcessSimd::SSE2; i<=best; i++ ) {
+        vector<unsigned char> hit;
+        ProcessSimd::setInstructions(ProcessSimd::Instructions(i));
+        findColorFrame(frame, hit, range);
+        bool same = sameMask(scalar, hit, frame.width, simdName(ProcessSimd::Instructions(i)));
+        printf(" %s %s", simdName(ProcessSimd::Instructions(i)), same ? "ok" : "FAIL");
+        ok = ok && same;
+    }
+    printf("\n");
+
+    return ok;
+}
+
+// ====================================================================
+// Motion
+// ====================================================================
+
+static void findMotionFrame(Frame &frame, Frame &prev, vector<unsigned char> &hit,
+                            int sensitivity)
+{
+    hit.assign(frame.width * frame.height, 0);
+    for ( int y=0; y<frame.height; y++ )
+        ProcessSimd::findMotion(frame.row(y), prev.row(y), &hit[y*frame.width],
+                                frame.width, sensitivity);
+}
+
+static bool checkMotion(Frame &frame, Frame &prev, int sensitivity,
+                        ProcessSimd::Instructions best, const char *name)
+{
+    vector<unsigned char> expected(frame.width * frame.height);
+    for ( unsigned int i=0; i<expected.size(); i++ ) {
+        int d = abs(frame.bgr[3*i+0] - prev.bgr[3*i+0]) +
+                abs(frame.bgr[3*i+1] - prev.bgr[3*i+1]) +
+                abs(frame.bgr[3*i+2] - prev.bgr[3*i+2]);
+        expected[i] = d > sensitivity ? 255 : 0;
+    }
+
+    vector<unsigned char> scalar;
+    ProcessSimd::setInstructions(ProcessSimd::Scalar);
+    findMotionFrame(frame, prev, scalar, sensitivity);
+
+    printf("motion %-6s sensitivity %3d", name, sensitivity);
+    bool ok = sameMask(expected, scalar, frame.width, "scalar vs sum");
+    printf(" scalar %s", ok ? "ok" : "FAIL");
+
+    for ( int i=ProcessSimd::SSE2; i<=best; i++ ) {
+        vector<unsigned char> hit;
+        ProcessSimd::setInstructions(ProcessSimd::Instructions(i));
+        findMotionFrame(frame, prev, hit, sensitivity);
+        bool same = sameMask(scalar, hit, frame.width, simdName(ProcessSimd::Instructions(i)));
+        printf(" %s %s", simdName(ProcessSimd::Instructions(i)), same ? "ok" : "FAIL");
+        ok = ok && same;
+    }
+    printf("\n");
+
+    return ok;
+}
+
+// ====================================================================
+// Background
+// ====================================================================
+
+// Модель фона кадра в том же виде, что и BackgroundModel
+struct Model {
+    int step;
+    vector<unsigned short> planes;
+
+    unsigned short *row(int y) { return &planes[y * ProcessSimd::PlaneCount * step]; }
+
+    // То же, что BackgroundModel::reset
+    void reset(Frame &frame) {
+        step = (frame.width + 15) & ~15;
+        planes.assign(ProcessSimd::PlaneCount * step * frame.height, 0);
+        for ( int y=0; y<frame.height; y++ )
+            for ( int c=0; c<3; c++ )
+                for ( int x=0; x<frame.width; x++ )
+                    row(y)[c*step + x] = frame.row(y)[3*x+c] << 8;
+    }
+};
+
+// Кадр n: шум вокруг медленно меняющейся яркости, мерцающая полоса
+// и прямоугольник, который движется по кадру
+static void backgroundFrame(Frame &frame, int n)
+{
+    int level = 60 + n * 3;
+    int bx = (n * 37) % frame.width;
+    int by = (n * 11) % frame.height;
+
+    for ( int y=0; y<frame.height; y++ ) {
+        unsigned char *p = frame.row(y);
+        for ( int x=0; x<frame.width; x++ ) {
+            for ( int c=0; c<3; c++ ) {
+                int v = level + c * 20 + rand() % 9 - 4;
+                if ( x >= 500 && x < 540 )
+                    v = rand() % 256;
+                if ( x >= bx && x < bx + 120 && y >= by && y < by + 80 )
+                    v = 255 - v;
+                p[3*x+c] = v < 0 ? 0 : v > 255 ? 255 : v;
+            }
+        }
+    }
+}
+
+static bool checkBackground(ProcessSimd::Instructions best)
+{
+    const int frames = 40;
+    Frame frame(FRAME_WIDTH, 120);
+
+    srand(2);
+    backgroundFrame(frame, 0);
+
+    vector<Model> models(best + 1);
+    for ( int i=ProcessSimd::Scalar; i<=best; i++ )
+        models[i].reset(frame);
+
+    bool ok = true;
+
+    for ( int n=1; n<=frames && ok; n++ ) {
+        backgroundFrame(frame, n);
+
+        ProcessSimd::BackgroundParam param;
+        param.sensitivity = (n * 53) % 200;
+        param.shift = 1 + n % 8;
+
+        vector<unsigned char> scalar;
+        for ( int i=ProcessSimd::Scalar; i<=best; i++ ) {
+            ProcessSimd::setInstructions(ProcessSimd::Instructions(i));
+
+            vector<unsigned char> hit(frame.width * frame.height, 0);
+            for ( int y=0; y<frame.height; y++ )
+                ProcessSimd::findBackground(frame.row(y), models[i].row(y), models[i].step,
+                                            &hit[y*frame.width], frame.width, param);
+
+            if ( i == ProcessSimd::Scalar ) {
+                scalar = hit;
+                continue;
+            }
+
+            if ( !sameMask(scalar, hit, frame.width, simdName(ProcessSimd::Instructions(i))) ) {
+                fprintf(stderr, "  frame %d\n", n);
+                ok = false;
+            }
+            if ( models[i].planes != models[ProcessSimd::Scalar].planes ) {
+                fprintf(stderr, "  %s: model differs after frame %d\n",
+                        simdName(ProcessSimd::Instructions(i)), n);
+                ok = false;
+            }
+        }
+    }
+
+    printf("background %d frames %s\n", frames, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    int rangeCount = 16;
+
+    for ( int i=1; i<argc; i++ ) {
+        if ( strcmp(argv[i], "--ranges") == 0 && i+1 < argc )
+            rangeCount = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "usage: simdtest [--ranges N]\n");
+            return 2;
+        }
+    }
+
+    ProcessSimd::Instructions best = ProcessSimd::supported();
+    printf("supported: %s\n", simdName(best));
+
+    bool ok = true;
+
+    // Color
+    vector<ColorCase> cases(edgeCases, edgeCases + sizeof(edgeCases)/sizeof(edgeCases[0]));
+    srand(1);
+    while ( (int)cases.size() < rangeCount ) {
+        ColorCase c;
+        c.invert = rand() % 2;
+        c.Hmin = rand() % 256;
+        c.Hmax = rand() % 256;
+        c.Smin = rand() % 4 ? rand() % 256 : 0;
+        c.Vmin = rand() % 4 ? rand() % 256 : 0;
+        cases.push_back(c);
+    }
+
+    {
+        vector<unsigned char> H, S, V;
+        Frame colors = allColors(H, S, V);
+        for ( unsigned int n=0; n<cases.size(); n++ )
+            ok = checkColor(colors, H, S, V, cases[n], best) && ok;
+    }
+
+    // Motion: все пары значений одного канала, остальные случайные
+    static const int sensitivities[] = { 0, 1, 2, 100, 254, 255, 256, 383, 510, 764, 765 };
+    const int sensitivityCount = sizeof(sensitivities)/sizeof(sensitivities[0]);
+
+    srand(3);
+    for ( int channel=0; channel<3; channel++ ) {
+        Frame frame(FRAME_WIDTH, (256*256 + FRAME_WIDTH - 1) / FRAME_WIDTH);
+        Frame prev(frame.width, frame.height);
+        for ( unsigned int i=0; i<frame.bgr.size(); i++ ) {
+            frame.bgr[i] = rand() % 256;
+            prev.bgr[i] = rand() % 256;
+        }
+        for ( int i=0; i<frame.width*frame.height; i++ ) {
+            frame.bgr[3*i+channel] = i & 0xff;
+            prev.bgr[3*i+channel] = (i >> 8) & 0xff;
+        }
+
+        static const char *names[] = { "b", "g", "r" };
+        for ( int n=0; n<sensitivityCount; n++ )
+            ok = checkMotion(frame, prev, sensitivities[n], best, names[channel]) && ok;
+    }
+
+    // Motion: шум, половина пикселей почти не меняется
+    {
+        Frame frame(FRAME_WIDTH, 480);
+        Frame prev(frame.width, frame.height);
+        for ( unsigned int i=0; i<frame.bgr.size(); i++ ) {
+            frame.bgr[i] = rand() % 256;
+            prev.bgr[i] = i % 6 < 3 ? frame.bgr[i] ^ (rand() % 8) : rand() % 256;
+        }
+        for ( int n=0; n<sensitivityCount; n++ )
+            ok = checkMotion(frame, prev, sensitivities[n], best, "noise") && ok;
+    }
+
+    // Background
+    ok = checkBackground(best) && ok;
+
+    printf("%s\n", ok ? "all kernels match" : "MISMATCH");
+    return ok ? 0 : 1;
+}